@@ -1,14 +1,64 @@
 #version 330 core
 
-uniform sampler2D tex_2d;
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	mat4 model;
+	vec4 light_dir;
+	float time;
+	int instance_base;
+};
 
-in vec3 vert_col;
+layout(std140) uniform Material {
+	vec4 base_color;
+	// Offset and scale of a virtual image in the page space.
+	vec4 virtual_rect;
+	int layer;
+	// Negative for textures of the array.
+	int virtual_max_level;
+};
+
+uniform sampler2DArray tex_array;
+// Page table entries are cache slot x, y and level of the resident page.
+uniform sampler2D page_table;
+uniform sampler2D tile_cache;
+
+in vec3 vert_norm;
 in vec2 vert_tex;
+in vec4 vert_col;
 
 out vec4 out_col;
 
+const float virtual_pages = 256.0;
+const float page_size = 128.0;
+const float tile_border = 1.0;
+
+// Virtual UV and mip level of the fragment.
+vec3 virtualCoord() {
+	vec2 uv = virtual_rect.xy + fract(vert_tex) * virtual_rect.zw;
+	vec2 texels = vert_tex * virtual_rect.zw * virtual_pages * page_size;
+	vec2 dx = dFdx(texels);
+	vec2 dy = dFdy(texels);
+	float level = floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0)));
+	return vec3(uv, clamp(level, 0.0, float(virtual_max_level)));
+}
+
+vec4 sampleVirtual() {
+	vec3 coord = virtualCoord();
+	int level = int(coord.z);
+	ivec2 page = ivec2(coord.xy * virtual_pages) >> level;
+	vec3 entry = texelFetch(page_table, page, level).rgb * 255.0;
+	// The entry may point to a coarser page than requested.
+	vec2 within = fract(coord.xy * virtual_pages / exp2(entry.b));
+	vec2 tile = entry.rg * (page_size + 2.0 * tile_border) + tile_border;
+	return textureLod(tile_cache, (tile + within * page_size) / vec2(textureSize(tile_cache, 0)), 0.0);
+}
+
 void main() {
-	vec4 texel = texture(tex_2d, vert_tex);
-	float greyscale_factor = dot(texel.rgb, vec3(0.21, 0.71, 0.07));
-	out_col = vec4(mix(vec3(greyscale_factor), vert_col.rgb, 0.7), 1.0f);
-}
\ No newline at end of file
+	vec4 texel = virtual_max_level >= 0 ? sampleVirtual() : texture(tex_array, vec3(vert_tex, float(layer)));
+	vec4 albedo = base_color * vert_col * texel;
+	// Meshes without normals are lit uniformly.
+	float diffuse = dot(vert_norm, vert_norm) > 0.0 ? max(dot(normalize(vert_norm), -light_dir.xyz), 0.0) : 1.0;
+	out_col = vec4(albedo.rgb * (0.2 + 0.8 * diffuse), albedo.a);
+}
@@ -1,16 +1,48 @@
 #version 330 core
 
-layout(location=0) in vec2 pos;
-layout(location=1) in vec3 col;
+layout(location=0) in vec3 pos;
+layout(location=1) in vec2 norm;
 layout(location=2) in vec2 tex;
+layout(location=3) in vec4 col;
+layout(location=4) in uint instance;
 
-uniform mat4 mvp;
+layout(std140) uniform Frame {
+	mat4 view;
+	mat4 projection;
+	mat4 view_projection;
+	mat4 model;
+	vec4 light_dir;
+	float time;
+	int instance_base;
+};
 
-out vec3 vert_col;
+// Six texels per instance: world matrix columns, dequantize scale and offset.
+uniform samplerBuffer instances;
+
+out vec3 vert_norm;
 out vec2 vert_tex;
+out vec4 vert_col;
+
+// Unfolds octahedral encoding, the lower hemisphere is mirrored over the diagonals.
+vec3 octahedral(vec2 encoded) {
+	vec3 n = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+	float fold = max(-n.z, 0.0);
+	n.xy += vec2(n.x >= 0.0 ? -fold : fold, n.y >= 0.0 ? -fold : fold);
+	return normalize(n);
+}
 
 void main() {
-	vert_col = col;
+	int record = (instance_base + int(instance)) * 6;
+	mat4 instance_world = mat4(texelFetch(instances, record), texelFetch(instances, record + 1),
+							   texelFetch(instances, record + 2), texelFetch(instances, record + 3));
+	vec4 dequantize_scale = texelFetch(instances, record + 4);
+	vec4 dequantize_offset = texelFetch(instances, record + 5);
+
+	mat4 world = model * instance_world;
+	vec3 position = pos * dequantize_scale.xyz + dequantize_offset.xyz;
+	// Missing normals are zeroed and missing colors become white.
+	vert_norm = mat3(world) * octahedral(norm) * dequantize_scale.w;
 	vert_tex = tex;
-	gl_Position = mvp * vec4(pos.xy, 0.0, 1.0);
+	vert_col = vec4(col.rgb + dequantize_offset.w, col.a);
+	gl_Position = view_projection * world * vec4(position, 1.0);
 }
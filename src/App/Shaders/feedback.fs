@@ -0,0 +1,35 @@
+#version 330 core
+
+// Writes the virtual page every fragment samples, see diffuse.fs.
+layout(std140) uniform Material {
+	vec4 base_color;
+	vec4 virtual_rect;
+	int layer;
+	int virtual_max_level;
+};
+
+// Feedback is drawn at a fraction of the viewport, so derivatives are
+// scaled back to the full resolution.
+uniform float lod_bias;
+
+in vec2 vert_tex;
+
+out vec4 out_page;
+
+const float virtual_pages = 256.0;
+const float page_size = 128.0;
+
+void main() {
+	if (virtual_max_level < 0) {
+		out_page = vec4(0.0);
+		return;
+	}
+	vec2 uv = virtual_rect.xy + fract(vert_tex) * virtual_rect.zw;
+	vec2 texels = vert_tex * virtual_rect.zw * virtual_pages * page_size;
+	vec2 dx = dFdx(texels);
+	vec2 dy = dFdy(texels);
+	float level = floor(0.5 * log2(max(max(dot(dx, dx), dot(dy, dy)), 1.0)) + lod_bias);
+	int clamped = int(clamp(level, 0.0, float(virtual_max_level)));
+	ivec2 page = ivec2(uv * virtual_pages) >> clamped;
+	out_page = vec4(vec3(page, clamped), 255.0) / 255.0;
+}
@@ -1,51 +1,99 @@
 #include "Window.h"
 
+#include <QDebug>
 #include <QMouseEvent>
-#include <QLabel>
 #include <QOpenGLFunctions>
 #include <QOpenGLShaderProgram>
-#include <QVBoxLayout>
 #include <QScreen>
 
-#include <array>
-
-#define TINYGLTF_IMPLEMENTATION
-#define STB_IMAGE_IMPLEMENTATION
-#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <Base/GltfLoader.hpp>
+#include <Base/MeshCache.hpp>
 
-#include <tinygltf/tiny_gltf.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
 
 namespace
 {
 
-constexpr std::array<GLfloat, 21u> vertices = {
-	0.0f, 0.707f, 1.f, 0.f, 0.f, 0.0f, 0.0f,
-	-0.5f, -0.5f, 0.f, 1.f, 0.f, 0.5f, 1.0f,
-	0.5f, -0.5f, 0.f, 0.f, 1.f, 1.0f, 0.0f,
+constexpr auto g_modelPath = ":/Models/chess.glb";
+constexpr auto g_rotationSpeed = 20.0f;// degrees per second
+constexpr auto g_zNear = 0.1f;
+constexpr auto g_zFar = 100.0f;
+// Coarser levels of detail are drawn while they deviate by less on screen.
+constexpr auto g_maxLodErrorPixels = 1.0f;
+// Largest visible occluders drawn into the software depth buffer per frame.
+constexpr size_t g_maxOccluders = 8;
+
+// Uniform buffer bindings of the blocks in diffuse.vs and diffuse.fs.
+constexpr GLuint g_frameBinding = 0;
+constexpr GLuint g_materialBinding = 1;
+constexpr auto g_noBlock = std::numeric_limits<size_t>::max();
+
+// Instance records are six vec4 texels: world matrix columns, dequantize
+// scale and offset. The stream starts with room for this many per frame.
+constexpr size_t g_recordFloats = 24;
+constexpr size_t g_recordSize = g_recordFloats * sizeof(float);
+constexpr size_t g_initialRecords = 1024;
+constexpr GLuint g_instanceUnit = 1;
+
+// Units of the virtual texture, feedback is drawn at a fraction of the
+// viewport and its mip levels are biased back to full resolution.
+constexpr GLuint g_pageTableUnit = 2;
+constexpr GLuint g_tileCacheUnit = 3;
+constexpr auto g_feedbackLodBias = -3.0f;
+static_assert(1 << -static_cast<int>(g_feedbackLodBias) == fgl::VirtualTexture::feedbackScale);
+
+// std140 layouts of the blocks.
+struct FrameBlock {
+	std::array<float, 16> view{};
+	std::array<float, 16> projection{};
+	std::array<float, 16> viewProjection{};
+	std::array<float, 16> model{};
+	std::array<float, 4> lightDir{};
+	float time = 0.0f;
+	// Record of the instance attribute zero in this frame.
+	int32_t instanceBase = 0;
+	std::array<float, 2> padding{};
 };
-constexpr std::array<GLuint, 3u> indices = {0, 1, 2};
 
-}// namespace
+struct MaterialBlock {
+	std::array<float, 4> baseColor{};
+	// Region of a virtual base color texture.
+	std::array<float, 4> virtualRect{};
+	// Layer of the base color texture array.
+	int32_t layer = 0;
+	// Negative when the base color texture is not virtual.
+	int32_t virtualMaxLevel = -1;
+	std::array<int32_t, 2> padding{};
+};
 
-Window::Window() noexcept
+std::array<float, 16> toArray(const QMatrix4x4 & matrix)
 {
-	const auto formatFPS = [](const auto value) {
-		return QString("FPS: %1").arg(QString::number(value));
-	};
-
-	auto fps = new QLabel(formatFPS(0), this);
-	fps->setStyleSheet("QLabel { color : white; }");
+	std::array<float, 16> result{};
+	std::copy_n(matrix.constData(), 16, result.begin());
+	return result;
+}
 
-	auto layout = new QVBoxLayout();
-	layout->addWidget(fps, 1);
+// Largest axis scale of a transform.
+float maxScale(const QMatrix4x4 & transform)
+{
+	auto result = 0.0f;
+	for (int column = 0; column < 3; ++column)
+	{
+		const QVector3D axis{transform(0, column), transform(1, column), transform(2, column)};
+		result = std::max(result, axis.length());
+	}
+	return result;
+}
 
-	setLayout(layout);
+}// namespace
 
+Window::Window() noexcept
+{
 	timer_.start();
-
-	connect(this, &Window::updateUI, [=] {
-		fps->setText(formatFPS(ui_.fps));
-	});
+	animationTimer_.start();
 }
 
 Window::~Window()
@@ -53,8 +101,19 @@ Window::~Window()
 	{
 		// Free resources with context bounded.
 		const auto guard = bindContext();
-		texture_.reset();
+		sceneLoader_.reset();
+		uploader_.release();
+		scene_.reset();
+		whiteTexture_.reset();
 		program_.reset();
+		feedbackProgram_.reset();
+		virtual_.release();
+		glDeleteTextures(1, &instanceTexture_);
+		instanceStream_.release();
+		queue_.release();
+		samplers_.release();
+		uniforms_.release();
+		overlay_.release();
 	}
 }
 
@@ -67,49 +126,71 @@ void Window::onInit()
 									  ":/Shaders/diffuse.fs");
 	program_->link();
 
-	// Create VAO object
-	vao_.create();
-	vao_.bind();
-
-	// Create VBO
-	vbo_.create();
-	vbo_.bind();
-	vbo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	vbo_.allocate(vertices.data(), static_cast<int>(vertices.size() * sizeof(GLfloat)));
-
-	// Create IBO
-	ibo_.create();
-	ibo_.bind();
-	ibo_.setUsagePattern(QOpenGLBuffer::StaticDraw);
-	ibo_.allocate(indices.data(), static_cast<int>(indices.size() * sizeof(GLuint)));
+	feedbackProgram_ = std::make_unique<QOpenGLShaderProgram>(this);
+	feedbackProgram_->addShaderFromSourceFile(QOpenGLShader::Vertex, ":/Shaders/diffuse.vs");
+	feedbackProgram_->addShaderFromSourceFile(QOpenGLShader::Fragment, ":/Shaders/feedback.fs");
+	feedbackProgram_->link();
 
-	texture_ = std::make_unique<QOpenGLTexture>(QImage(":/Textures/voronoi.png"));
-	texture_->setMinMagFilters(QOpenGLTexture::Linear, QOpenGLTexture::Linear);
-	texture_->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
-
-	// Bind attributes
-	program_->bind();
-
-	program_->enableAttributeArray(0);
-	program_->setAttributeBuffer(0, GL_FLOAT, 0, 2, static_cast<int>(7 * sizeof(GLfloat)));
-
-	program_->enableAttributeArray(1);
-	program_->setAttributeBuffer(1, GL_FLOAT, static_cast<int>(2 * sizeof(GLfloat)), 3,
-								 static_cast<int>(7 * sizeof(GLfloat)));
-
-	program_->enableAttributeArray(2);
-	program_->setAttributeBuffer(2, GL_FLOAT, static_cast<int>(5 * sizeof(GLfloat)), 2,
-								 static_cast<int>(7 * sizeof(GLfloat)));
-
-	mvpUniform_ = program_->uniformLocation("mvp");
+	// Load scene in background, it is picked up by onRender once ready
+	sceneLoader_ = std::make_unique<fgl::AsyncSceneLoader>();
+	if (sceneLoader_->isValid())
+	{
+		connect(sceneLoader_.get(), &fgl::AsyncSceneLoader::ready, this, [this] { update(); });
+		sceneLoader_->load(g_modelPath);
+	}
+	else
+	{
+		// No shared context, load synchronously and stream textures
+		fgl::MeshCache cache;
+		fgl::GltfLoader loader(&cache);
+		uploader_.initialize();
+		loader.setTextureUploader(&uploader_);
+		scene_ = loader.load(g_modelPath);
+		if (scene_)
+		{
+			bvh_.build(*scene_);
+		}
+		else
+		{
+			qWarning() << "Failed to load" << g_modelPath << ":" << loader.error();
+		}
+	}
 
-	// Release all
-	program_->release();
+	// Single layer array, as all scene textures are arrays
+	const std::array<uint8_t, 4> white{255, 255, 255, 255};
+	whiteTexture_ = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2DArray);
+	whiteTexture_->setSize(1, 1);
+	whiteTexture_->setLayers(1);
+	whiteTexture_->setMipLevels(1);
+	whiteTexture_->setFormat(QOpenGLTexture::RGBA8_UNorm);
+	whiteTexture_->allocateStorage();
+	whiteTexture_->setData(0, 0, QOpenGLTexture::RGBA, QOpenGLTexture::UInt8, white.data());
+
+	// Bind samplers to texture units and blocks to their buffer bindings
+	for (auto * program: {program_.get(), feedbackProgram_.get()})
+	{
+		program->bind();
+		program->setUniformValue("tex_array", 0);
+		program->setUniformValue("instances", static_cast<GLint>(g_instanceUnit));
+		program->setUniformValue("page_table", static_cast<GLint>(g_pageTableUnit));
+		program->setUniformValue("tile_cache", static_cast<GLint>(g_tileCacheUnit));
+		program->setUniformValue("lod_bias", g_feedbackLodBias);
+		const auto programId = program->programId();
+		glUniformBlockBinding(programId, glGetUniformBlockIndex(programId, "Frame"), g_frameBinding);
+		glUniformBlockBinding(programId, glGetUniformBlockIndex(programId, "Material"), g_materialBinding);
+		program->release();
+	}
 
-	vao_.release();
+	uniforms_.initialize();
+	queue_.initialize();
+	samplers_.initialize();
+	virtual_.initialize();
+	qInfo() << "Max anisotropy" << samplers_.maxAnisotropy();
+	qInfo() << "Indirect multi-draw" << (queue_.isIndirect() ? "enabled" : "unavailable, drawing packets one by one");
+	instanceStream_.initialize(g_initialRecords * g_recordSize);
+	glGenTextures(1, &instanceTexture_);
 
-	ibo_.release();
-	vbo_.release();
+	overlay_.initialize();
 
 	// Еnable depth test and face culling
 	glEnable(GL_DEPTH_TEST);
@@ -124,51 +205,306 @@ void Window::onRender()
 	const auto guard = captureMetrics();
 
 	// Clear buffers
-	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	{
+		const auto scope = profiler().scope("clear");
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+	}
+
+	// Pick up streamed resources
+	{
+		const auto scope = profiler().scope("upload");
+		if (sceneLoader_ && sceneLoader_->poll(scene_))
+		{
+			bvh_.build(*scene_);
+			virtual_.clear();
+			virtualImages_.clear();
+		}
+		if (scene_)
+		{
+			for (auto & texture: uploader_.upload())
+			{
+				scene_->addTexture(std::move(texture));
+			}
+		}
+	}
+	profiler().setCounter("queued upload MiB", static_cast<float>(uploader_.pendingBytes()) / static_cast<float>(1 << 20));
+
+	if (scene_)
+	{
+		renderScene();
+	}
+
+	// Draw statistics on top
+	{
+		const auto scope = profiler().scope("overlay");
+		overlay_.render(profiler().frameTimes(), viewport_.width(), viewport_.height());
+	}
+
+	// Request redraw if animated
+	if (animated_)
+	{
+		update();
+	}
+}
 
-	// Calculate MVP matrix
+void Window::renderScene()
+{
+	// Load pages wanted by previous frames and map newly loaded images
+	{
+		const auto scope = profiler().scope("virtual");
+		virtual_.update();
+		while (virtualImages_.size() < scene_->tiledImages.size())
+		{
+			virtualImages_.push_back(virtual_.add(scene_->tiledImages[virtualImages_.size()]));
+		}
+	}
+	profiler().setCounter("resident pages", static_cast<float>(virtual_.residentPages()));
+	profiler().setCounter("missing pages", static_cast<float>(virtual_.missingPages()));
+
+	// Fit scene into unit sphere and rotate it
+	const auto center = scene_->bounds.center();
+	const auto radius = std::max(scene_->bounds.radius(), 1e-6f);
+	const auto angle = animated_ ? g_rotationSpeed * static_cast<float>(animationTimer_.elapsed()) / 1000.0f : 0.0f;
 	model_.setToIdentity();
 	model_.translate(0, 0, -2);
+	model_.rotate(30.0f, 1.0f, 0.0f, 0.0f);
+	model_.rotate(angle, 0.0f, 1.0f, 0.0f);
+	model_.scale(1.0f / radius);
+	model_.translate(-center);
 	view_.setToIdentity();
-	const auto mvp = projection_ * view_ * model_;
+	const auto viewProjection = projection_ * view_;
 
-	// Bind VAO and shader program
-	program_->bind();
-	vao_.bind();
+	// Cull nodes outside of the view
+	{
+		const auto scope = profiler().scope("cull");
+		bvh_.cull(viewProjection * model_, visibleNodes_);
+	}
 
-	// Update uniform value
-	program_->setUniformValue(mvpUniform_, mvp);
+	// Hide nodes behind the nearest large occluders
+	size_t occluded = 0;
+	{
+		const auto scope = profiler().scope("occlusion");
+		occluders_.clear();
+		for (const auto index: visibleNodes_)
+		{
+			if (scene_->meshes[scene_->nodes[index].mesh].occluder.indices.empty())
+			{
+				continue;
+			}
+			const auto bounds = bvh_.bounds(index).transformed(view_ * model_);
+			occluders_.emplace_back(bounds.radius() / std::max(-bounds.center().z(), 1e-3f), index);
+		}
+		const auto count = std::min(occluders_.size(), g_maxOccluders);
+		std::partial_sort(occluders_.begin(), occluders_.begin() + static_cast<std::ptrdiff_t>(count), occluders_.end(),
+						  [](const auto & lhs, const auto & rhs) { return lhs.first > rhs.first; });
+
+		occlusion_.begin(viewProjection * model_);
+		for (size_t i = 0; i < count; ++i)
+		{
+			const auto & node = scene_->nodes[occluders_[i].second];
+			occlusion_.drawOccluder(scene_->meshes[node.mesh].occluder, node.world);
+		}
+		occlusion_.finish();
 
-	// Activate texture unit and bind texture
-	glActiveTexture(GL_TEXTURE0);
-	texture_->bind();
+		const auto visible = visibleNodes_.size();
+		std::erase_if(visibleNodes_, [&](const uint32_t index) { return occlusion_.isOccluded(bvh_.bounds(index)); });
+		occluded = visible - visibleNodes_.size();
+	}
 
-	// Draw
-	glDrawElements(GL_TRIANGLES, 3, GL_UNSIGNED_INT, nullptr);
+	// Group visible nodes by mesh
+	{
+		const auto scope = profiler().scope("instances");
+
+		// Instanced meshes are sorted by their nearest visible instance and
+		// get the level of detail it needs
+		visibleInstances_.assign(scene_->meshes.size(), 0);
+		meshDepths_.assign(scene_->meshes.size(), 1.0f);
+		meshPixelScales_.assign(scene_->meshes.size(), 0.0f);
+		const auto pixelsPerUnit = projection_(1, 1) * static_cast<float>(viewport_.height()) * 0.5f;
+		for (const auto index: visibleNodes_)
+		{
+			const auto & node = scene_->nodes[index];
+			const auto & mesh = scene_->meshes[node.mesh];
+			++visibleInstances_[node.mesh];
+
+			const auto modelView = view_ * model_ * node.world;
+			const auto center = modelView.map(mesh.bounds.center());
+			meshDepths_[node.mesh] = std::min(meshDepths_[node.mesh], -center.z() / g_zFar);
+
+			// Pixels per object space unit at the nearest point of the bounds.
+			const auto scale = maxScale(modelView);
+			const auto distance = std::max(-center.z() - mesh.bounds.radius() * scale, g_zNear);
+			meshPixelScales_[node.mesh] = std::max(meshPixelScales_[node.mesh], scale * pixelsPerUnit / distance);
+		}
 
-	// Release VAO and shader program
-	texture_->release();
-	vao_.release();
-	program_->release();
+		// Groups are filled from their ends, which leaves their starts behind.
+		firstVisible_.resize(scene_->meshes.size());
+		uint32_t end = 0;
+		for (size_t i = 0; i < scene_->meshes.size(); ++i)
+		{
+			end += static_cast<uint32_t>(visibleInstances_[i]);
+			firstVisible_[i] = end;
+		}
+		visibleOrder_.resize(visibleNodes_.size());
+		for (auto it = visibleNodes_.rbegin(); it != visibleNodes_.rend(); ++it)
+		{
+			visibleOrder_[--firstVisible_[scene_->nodes[*it].mesh]] = *it;
+		}
+	}
+	profiler().setCounter("visible nodes", static_cast<float>(visibleNodes_.size()));
+	profiler().setCounter("occluded nodes", static_cast<float>(occluded));
 
-	++frameCount_;
+	// Queue primitives of every mesh with its visible instances, blocks of
+	// their materials are gathered along
+	uniforms_.begin();
+	materialBlocks_.assign(scene_->materials.size() + 1, g_noBlock);
+	{
+		const auto scope = profiler().scope("queue");
+		queue_.clear();
+		instanceRecords_.clear();
+		for (size_t i = 0; i < scene_->meshes.size(); ++i)
+		{
+			const auto & mesh = scene_->meshes[i];
+			for (const auto & primitive: mesh.primitives)
+			{
+				if (!visibleInstances_[i] || !primitive.count)
+				{
+					continue;
+				}
+				const auto image = primitive.material >= 0 ? scene_->materials[static_cast<size_t>(primitive.material)].baseColorTexture : -1;
+				const auto slot = image >= 0 ? scene_->images[static_cast<size_t>(image)] : fgl::ImageTexture{};
+				const auto textureIndex = slot.texture;
+				auto * texture = textureIndex >= 0 ? scene_->textures[static_cast<size_t>(textureIndex)].get() : whiteTexture_.get();
+
+				// Coarsest level still within the screen space error.
+				auto count = primitive.count;
+				auto indexOffset = primitive.indexOffset;
+				for (const auto & lod: primitive.lods)
+				{
+					if (lod.error * meshPixelScales_[i] > g_maxLodErrorPixels)
+					{
+						break;
+					}
+					count = lod.count;
+					indexOffset = lod.indexOffset;
+				}
+
+				// Zero ids are for the white texture and the default material.
+				const auto material = static_cast<uint32_t>(primitive.material + 1);
+				if (materialBlocks_[material] == g_noBlock)
+				{
+					const auto color = material ? scene_->materials[material - 1].baseColor : QVector4D{1.0f, 1.0f, 1.0f, 1.0f};
+					MaterialBlock block{{color.x(), color.y(), color.z(), color.w()}, {}, slot.layer, -1, {}};
+					const auto virtualImage = slot.tiled >= 0 ? virtualImages_[static_cast<size_t>(slot.tiled)] : -1;
+					if (virtualImage >= 0)
+					{
+						block.virtualRect = virtual_.rect(virtualImage);
+						block.virtualMaxLevel = virtual_.maxLevel(virtualImage);
+					}
+					materialBlocks_[material] = uniforms_.append(block);
+				}
+				// Instances of a primitive get consecutive records.
+				const auto firstInstance = static_cast<GLuint>(instanceRecords_.size() / g_recordFloats);
+				for (GLsizei j = 0; j < visibleInstances_[i]; ++j)
+				{
+					const auto * world = scene_->nodes[visibleOrder_[firstVisible_[i] + static_cast<uint32_t>(j)]].world.constData();
+					instanceRecords_.insert(instanceRecords_.end(), world, world + 16);
+					instanceRecords_.insert(instanceRecords_.end(), primitive.dequantizeScale.begin(), primitive.dequantizeScale.end());
+					instanceRecords_.insert(instanceRecords_.end(), primitive.dequantizeOffset.begin(), primitive.dequantizeOffset.end());
+				}
+
+				// Primitives of a vertex format share a vertex array.
+				const auto pool = primitive.geometry.pool;
+				const auto key = fgl::RenderQueue::makeKey(0, material, static_cast<uint32_t>(textureIndex + 1), pool + 1, meshDepths_[i]);
+				queue_.push(key, {program_.get(), scene_->geometry.vertexArray(pool), texture, primitive.mode, count, primitive.indexType,
+								  indexOffset, primitive.geometry.baseVertex, visibleInstances_[i], firstInstance, material});
+			}
+		}
+		queue_.sort();
+	}
 
-	// Request redraw if animated
-	if (animated_)
+	// Upload instance records and all blocks of the frame at once
+	size_t frameBlock = 0;
 	{
-		update();
+		const auto scope = profiler().scope("uniforms");
+		const auto recordBytes = instanceRecords_.size() * sizeof(float);
+		instanceStream_.begin(recordBytes + g_recordSize);
+		const auto records = instanceStream_.allocate(recordBytes, g_recordSize);
+		if (records.data)
+		{
+			std::memcpy(records.data, instanceRecords_.data(), recordBytes);
+			countUpload(recordBytes);
+		}
+		instanceStream_.finish();
+
+		const auto lightDir = QVector3D{-0.3f, -1.0f, -0.5f}.normalized();
+		FrameBlock frame;
+		frame.view = toArray(view_);
+		frame.projection = toArray(projection_);
+		frame.viewProjection = toArray(viewProjection);
+		frame.model = toArray(model_);
+		frame.lightDir = {lightDir.x(), lightDir.y(), lightDir.z(), 0.0f};
+		frame.time = static_cast<float>(animationTimer_.elapsed()) / 1000.0f;
+		frame.instanceBase = static_cast<int32_t>(records.offset / g_recordSize);
+		frameBlock = uniforms_.append(frame);
+		uniforms_.upload(*this);
+	}
+
+	// Bind instance records, storage of the stream may have been reallocated
+	glActiveTexture(GL_TEXTURE0 + g_instanceUnit);
+	glBindTexture(GL_TEXTURE_BUFFER, instanceTexture_);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, instanceStream_.buffer());
+
+	// Bind virtual texture and activate texture unit
+	virtual_.bind(g_pageTableUnit, g_tileCacheUnit);
+	glActiveTexture(GL_TEXTURE0);
+
+	// Draw
+	const auto setMaterial = [&](QOpenGLShaderProgram &, const uint32_t material) {
+		uniforms_.bind(g_materialBinding, materialBlocks_[material], sizeof(MaterialBlock));
+		// Shared samplers override filtering of the bound texture.
+		const auto & policy = material ? scene_->materials[material - 1].sampler : fgl::SamplerPolicy{};
+		glBindSampler(0, samplers_.sampler(policy));
+	};
+	{
+		const auto scope = profiler().scope("draw");
+		uniforms_.bind(g_frameBinding, frameBlock, sizeof(FrameBlock));
+		queue_.setInstanceIndices(static_cast<GLuint>(fgl::Attribute::Instance), scene_->geometry.instanceBuffer());
+		queue_.submit(*this, [](QOpenGLShaderProgram &) {}, setMaterial);
+		glBindSampler(0, 0);
 	}
+
+	// Draw the same packets again into the virtual texture feedback
+	if (virtual_.beginFeedback(viewport_.width(), viewport_.height()))
+	{
+		const auto scope = profiler().scope("feedback");
+		queue_.submit(*this, [](QOpenGLShaderProgram &) {}, setMaterial, feedbackProgram_.get());
+		glBindSampler(0, 0);
+		virtual_.endFeedback();
+	}
+	queue_.fence();
+	uniforms_.fence();
+	instanceStream_.fence();
+	// Every per-frame stream waits for its partition in its own begin().
+	const auto stalls = uniforms_.stream().stalls() + instanceStream_.stalls() + queue_.stalls();
+	profiler().setCounter("stream stalls", static_cast<float>(stalls));
+}
+
+bool Window::isLoading() const
+{
+	return (sceneLoader_ && !sceneLoader_->isIdle()) || !uploader_.isIdle();
 }
 
 void Window::onResize(const size_t width, const size_t height)
 {
 	// Configure viewport
+	viewport_ = QSize{static_cast<int>(width), static_cast<int>(height)};
 	glViewport(0, 0, static_cast<GLint>(width), static_cast<GLint>(height));
 
 	// Configure matrix
 	const auto aspect = static_cast<float>(width) / static_cast<float>(height);
-	const auto zNear = 0.1f;
-	const auto zFar = 100.0f;
+	const auto zNear = g_zNear;
+	const auto zFar = g_zFar;
 	const auto fov = 60.0f;
 	projection_.setToIdentity();
 	projection_.perspective(fov, aspect, zNear, zFar);
@@ -193,10 +529,8 @@ auto Window::captureMetrics() -> PerfomanceMetricsGuard
 		[&] {
 			if (timer_.elapsed() >= 1000)
 			{
-				const auto elapsedSeconds = static_cast<float>(timer_.restart()) / 1000.0f;
-				ui_.fps = static_cast<size_t>(std::round(frameCount_ / elapsedSeconds));
-				frameCount_ = 0;
-				emit updateUI();
+				timer_.restart();
+				overlay_.update(profiler().report(), drawCounters());
 			}
 		}
 	};
@@ -1,16 +1,28 @@
 #pragma once
 
 #include <Base/GLWidget.hpp>
+#include <Base/AsyncSceneLoader.hpp>
+#include <Base/FrameOverlay.hpp>
+#include <Base/OcclusionCuller.hpp>
+#include <Base/RenderQueue.hpp>
+#include <Base/SamplerCache.hpp>
+#include <Base/Scene.hpp>
+#include <Base/SceneBvh.hpp>
+#include <Base/StreamBuffer.hpp>
+#include <Base/TextureUploader.hpp>
+#include <Base/UniformRing.hpp>
+#include <Base/VirtualTexture.hpp>
 
 #include <QElapsedTimer>
 #include <QMatrix4x4>
-#include <QOpenGLBuffer>
 #include <QOpenGLShaderProgram>
 #include <QOpenGLTexture>
-#include <QOpenGLVertexArrayObject>
+#include <QSize>
 
 #include <functional>
 #include <memory>
+#include <utility>
+#include <vector>
 
 class Window final : public fgl::GLWidget
 {
@@ -23,6 +35,10 @@ public: // fgl::GLWidget
 	void onInit() override;
 	void onRender() override;
 	void onResize(size_t width, size_t height) override;
+	[[nodiscard]] bool isLoading() const override;
+
+private:
+	void renderScene();
 
 private:
 	class PerfomanceMetricsGuard final
@@ -44,29 +60,53 @@ private:
 private:
 	[[nodiscard]] PerfomanceMetricsGuard captureMetrics();
 
-signals:
-	void updateUI();
-
 private:
-	GLint mvpUniform_ = -1;
-
-	QOpenGLBuffer vbo_{QOpenGLBuffer::Type::VertexBuffer};
-	QOpenGLBuffer ibo_{QOpenGLBuffer::Type::IndexBuffer};
-	QOpenGLVertexArrayObject vao_;
-
 	QMatrix4x4 model_;
 	QMatrix4x4 view_;
 	QMatrix4x4 projection_;
-
-	std::unique_ptr<QOpenGLTexture> texture_;
+	QSize viewport_;
+
+	std::unique_ptr<fgl::AsyncSceneLoader> sceneLoader_;
+	std::unique_ptr<fgl::Scene> scene_;
+	// Streams textures of synchronously loaded scenes over several frames.
+	fgl::TextureUploader uploader_;
+	// Bound for materials without base color texture.
+	std::unique_ptr<QOpenGLTexture> whiteTexture_;
 	std::unique_ptr<QOpenGLShaderProgram> program_;
+	// Draws virtual pages wanted by fragments instead of their colors.
+	std::unique_ptr<QOpenGLShaderProgram> feedbackProgram_;
+
+	fgl::SceneBvh bvh_;
+	std::vector<uint32_t> visibleNodes_;
+	fgl::OcclusionCuller occlusion_;
+	// Screen size estimate and node of occluder candidates.
+	std::vector<std::pair<float, uint32_t>> occluders_;
+	std::vector<GLsizei> visibleInstances_;
+	// Visible nodes grouped by mesh, groups start at firstVisible_.
+	std::vector<uint32_t> visibleOrder_;
+	std::vector<uint32_t> firstVisible_;
+	std::vector<float> meshDepths_;
+	// Screen pixels per object space unit of the nearest visible instance.
+	std::vector<float> meshPixelScales_;
+	fgl::RenderQueue queue_;
+	// Sampler objects of material policies.
+	fgl::SamplerCache samplers_;
+	// Pages of large images, ids of the scene's tiled images added so far.
+	fgl::VirtualTexture virtual_;
+	std::vector<int> virtualImages_;
+	// Record of every visible instance of queued primitives: world matrix
+	// and dequantization constants, fetched through a buffer texture.
+	std::vector<float> instanceRecords_;
+	fgl::StreamBuffer instanceStream_;
+	GLuint instanceTexture_ = 0;
+	fgl::UniformRing uniforms_;
+	// Offsets of material blocks in this frame's uniforms, by material id.
+	std::vector<size_t> materialBlocks_;
 
 	QElapsedTimer timer_;
-	size_t frameCount_ = 0;
+	QElapsedTimer animationTimer_;
 
-	struct {
-		size_t fps = 0;
-	} ui_;
+	fgl::FrameOverlay overlay_;
 
 	bool animated_ = true;
 };
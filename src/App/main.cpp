@@ -1,5 +1,12 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QJsonDocument>
 #include <QSurfaceFormat>
+#include <QTextStream>
+
+#include <algorithm>
+
+#include <Base/OffscreenRunner.hpp>
 
 #include "Window.h"
 
@@ -8,6 +15,23 @@ namespace
 constexpr auto g_sampels = 16;
 constexpr auto g_gl_major_version = 3;
 constexpr auto g_gl_minor_version = 3;
+
+int runBenchmark(const fgl::OffscreenRunner::Settings & settings)
+{
+	// Runner owns the context, so it has to outlive the window.
+	fgl::OffscreenRunner runner{settings};
+	if (!runner.isValid())
+	{
+		qCritical() << "Failed to create offscreen context and framebuffer.";
+		return 1;
+	}
+
+	Window window;
+	const auto result = runner.run(window);
+
+	QTextStream(stdout) << QJsonDocument(result.toJson()).toJson(QJsonDocument::Compact) << "\n";
+	return 0;
+}
 }// namespace
 
 int main(int argc, char ** argv)
@@ -16,6 +40,22 @@ int main(int argc, char ** argv)
 	QApplication::setAttribute(Qt::AA_UseDesktopOpenGL);
 	QApplication app(argc, argv);
 
+	// Parse command line.
+	QCommandLineParser parser;
+	parser.setApplicationDescription("OpenGL demo application.");
+	parser.addHelpOption();
+	const QCommandLineOption benchmarkOption("benchmark", "Render <frames> frames offscreen and print JSON timings.", "frames");
+	const QCommandLineOption warmupOption("warmup", "Frames rendered before measuring.", "frames", "60");
+	const QCommandLineOption widthOption("width", "Benchmark framebuffer width.", "pixels", "1280");
+	const QCommandLineOption heightOption("height", "Benchmark framebuffer height.", "pixels", "720");
+	const QCommandLineOption samplesOption("samples", "Benchmark MSAA samples.", "count", QString::number(g_sampels));
+	parser.addOption(benchmarkOption);
+	parser.addOption(warmupOption);
+	parser.addOption(widthOption);
+	parser.addOption(heightOption);
+	parser.addOption(samplesOption);
+	parser.process(app);
+
 	// Set default surface format.
 	QSurfaceFormat format;
 	format.setSamples(g_sampels);
@@ -23,10 +63,21 @@ int main(int argc, char ** argv)
 	format.setProfile(QSurfaceFormat::CoreProfile);
 	QSurfaceFormat::setDefaultFormat(format);
 
+	if (parser.isSet(benchmarkOption))
+	{
+		fgl::OffscreenRunner::Settings settings;
+		settings.frames = parser.value(benchmarkOption).toULongLong();
+		settings.warmupFrames = parser.value(warmupOption).toULongLong();
+		settings.width = std::max(parser.value(widthOption).toULongLong(), 1ull);
+		settings.height = std::max(parser.value(heightOption).toULongLong(), 1ull);
+		settings.samples = parser.value(samplesOption).toInt();
+		return runBenchmark(settings);
+	}
+
 	// Now create window.
 	Window window;
 	window.resize(640, 480);
 	window.show();
 
 	return app.exec();
-}
\ No newline at end of file
+}
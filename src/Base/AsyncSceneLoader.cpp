@@ -0,0 +1,234 @@
+#include "AsyncSceneLoader.hpp"
+
+#include "GltfLoader.hpp"
+#include "ImageDecoder.hpp"
+#include "MeshCache.hpp"
+#include "TextureCache.hpp"
+
+#include <QDebug>
+#include <QMutexLocker>
+#include <QOpenGLExtraFunctions>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Larger images are streamed through the renderer's virtual texture.
+constexpr int g_virtualImageSize = 4096;
+
+}// namespace
+
+AsyncSceneLoader::AsyncSceneLoader()
+{
+	auto * share = QOpenGLContext::currentContext();
+	surface_.setFormat(share->format());
+	surface_.create();
+
+	context_ = std::make_unique<QOpenGLContext>();
+	context_->setFormat(share->format());
+	context_->setShareContext(share);
+	if (!surface_.isValid() || !context_->create())
+	{
+		context_.reset();
+		return;
+	}
+
+	// Without fences the loader waits for its own work with glFinish.
+	const auto format = context_->format();
+	const auto version = qMakePair(format.majorVersion(), format.minorVersion());
+	fences_ = context_->isOpenGLES() ? version >= qMakePair(3, 0)
+									 : version >= qMakePair(3, 2) || context_->hasExtension("GL_ARB_sync");
+
+	thread_.reset(QThread::create([this] { run(); }));
+	context_->moveToThread(thread_.get());
+	thread_->start();
+}
+
+AsyncSceneLoader::~AsyncSceneLoader()
+{
+	if (thread_)
+	{
+		{
+			QMutexLocker lock(&mutex_);
+			stop_ = true;
+			requested_.wakeAll();
+		}
+		thread_->wait();
+	}
+
+	auto * gl = QOpenGLContext::currentContext() ? QOpenGLContext::currentContext()->extraFunctions() : nullptr;
+	for (auto & batch: batches_)
+	{
+		if (batch.fence && gl)
+		{
+			gl->glDeleteSync(batch.fence);
+		}
+	}
+	batches_.clear();
+	context_.reset();
+}
+
+bool AsyncSceneLoader::isValid() const noexcept
+{
+	return thread_ != nullptr;
+}
+
+void AsyncSceneLoader::load(const QString & path)
+{
+	QMutexLocker lock(&mutex_);
+	path_ = path;
+	++generation_;
+	requested_.wakeAll();
+}
+
+bool AsyncSceneLoader::poll(std::unique_ptr<Scene> & scene)
+{
+	auto * gl = QOpenGLContext::currentContext()->extraFunctions();
+	auto changed = false;
+	while (true)
+	{
+		Batch batch;
+		{
+			QMutexLocker lock(&mutex_);
+			if (batches_.empty())
+			{
+				break;
+			}
+			// Batches are fenced in order, so only the front one is checked.
+			auto & front = batches_.front();
+			if (front.fence)
+			{
+				if (gl->glClientWaitSync(front.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				{
+					break;
+				}
+				gl->glDeleteSync(front.fence);
+				front.fence = nullptr;
+			}
+			batch = std::move(front);
+			batches_.pop_front();
+		}
+
+		// Textures of replaced scenes are dropped here with the render context bound.
+		if (batch.scene)
+		{
+			batch.scene->geometry.updateVertexArrays();
+			scene = std::move(batch.scene);
+			sceneGeneration_ = batch.generation;
+			changed = true;
+		}
+		else if (scene && batch.generation == sceneGeneration_)
+		{
+			for (auto & texture: batch.uploads.textures)
+			{
+				scene->addTexture(std::move(texture));
+			}
+			for (auto & [index, tiled]: batch.uploads.tiled)
+			{
+				scene->addTiled(index, std::move(tiled));
+			}
+		}
+	}
+	return changed;
+}
+
+bool AsyncSceneLoader::isIdle() const
+{
+	QMutexLocker lock(&mutex_);
+	return path_.isEmpty() && !loading_ && batches_.empty();
+}
+
+void AsyncSceneLoader::run()
+{
+	context_->makeCurrent(&surface_);
+	{
+		MeshCache cache;
+		GltfLoader loader(&cache);
+		TextureCache textureCache;
+		ImageDecoder decoder(&textureCache);
+		// Textures are block compressed where the context can sample them.
+		decoder.setCompression(isTextureCompressionSupported());
+		decoder.setVirtualSize(g_virtualImageSize);
+		while (true)
+		{
+			QString path;
+			size_t generation = 0;
+			{
+				QMutexLocker lock(&mutex_);
+				while (!stop_ && path_.isEmpty())
+				{
+					requested_.wait(&mutex_);
+				}
+				if (stop_)
+				{
+					break;
+				}
+				path.swap(path_);
+				generation = generation_;
+				loading_ = generation;
+			}
+
+			CookedScene cooked;
+			if (loader.cook(path, cooked))
+			{
+				// Meshes go first, images are decoding meanwhile.
+				auto scene = loader.uploadResources(cooked, &decoder);
+				publish({generation, std::move(scene), {}, nullptr});
+
+				// Small images are held until the last one, batches may be empty.
+				while (isCurrent(generation) && !decoder.isIdle())
+				{
+					decoder.wait();
+					auto uploads = decoder.uploadFinished();
+					if (!uploads.isEmpty())
+					{
+						publish({generation, nullptr, std::move(uploads), nullptr});
+					}
+				}
+				decoder.cancel();
+			}
+			else
+			{
+				qWarning() << "Failed to load" << path << ":" << loader.error();
+			}
+
+			QMutexLocker lock(&mutex_);
+			loading_ = 0;
+		}
+	}
+
+	// Context is destroyed by the owner thread.
+	context_->doneCurrent();
+	context_->moveToThread(thread());
+}
+
+void AsyncSceneLoader::publish(Batch batch)
+{
+	auto * gl = context_->extraFunctions();
+	if (fences_)
+	{
+		batch.fence = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		// Fence has to reach the GPU to ever be signaled.
+		gl->glFlush();
+	}
+	else
+	{
+		gl->glFinish();
+	}
+
+	{
+		QMutexLocker lock(&mutex_);
+		batches_.push_back(std::move(batch));
+	}
+	emit ready();
+}
+
+bool AsyncSceneLoader::isCurrent(const size_t generation) const
+{
+	QMutexLocker lock(&mutex_);
+	return !stop_ && generation == generation_;
+}
+
+}// namespace fgl
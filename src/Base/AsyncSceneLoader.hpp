@@ -0,0 +1,90 @@
+#pragma once
+
+#include "ImageDecoder.hpp"
+#include "Scene.hpp"
+
+#include <QMutex>
+#include <QObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QString>
+#include <QThread>
+#include <QWaitCondition>
+
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// Loads scenes on a background thread with its own context shared with the
+// render one. Buffers and textures are created there and each batch is
+// followed by a fence, the render thread picks batches up once their fences
+// are signaled. Meshes arrive first, textures stream in as images finish
+// decoding, so the render thread never waits for the loader.
+class AsyncSceneLoader final : public QObject
+{
+	Q_OBJECT
+public:
+	// Requires a bound context, resources are shared with it.
+	AsyncSceneLoader();
+	// Requires the same context bound to free resources not taken yet.
+	~AsyncSceneLoader() override;
+
+	AsyncSceneLoader(const AsyncSceneLoader &) = delete;
+	AsyncSceneLoader(AsyncSceneLoader &&) = delete;
+	AsyncSceneLoader & operator=(const AsyncSceneLoader &) = delete;
+	AsyncSceneLoader & operator=(AsyncSceneLoader &&) = delete;
+
+	[[nodiscard]] bool isValid() const noexcept;
+
+	// Queues loading, replaces a scene being loaded.
+	void load(const QString & path);
+
+	// Applies batches whose GPU work has finished, replaces the scene when
+	// a new one is ready. Returns true if scene changed. Requires a bound
+	// render context.
+	bool poll(std::unique_ptr<Scene> & scene);
+
+	// No requests are queued or in flight.
+	[[nodiscard]] bool isIdle() const;
+
+signals:
+	// Emitted from the loader thread when a batch is ready to be polled.
+	void ready();
+
+private:
+	struct Batch {
+		size_t generation = 0;
+		// Set for the first batch of a scene.
+		std::unique_ptr<Scene> scene;
+		ImageDecoder::Uploads uploads;
+		// Null when fences are not supported, the batch is finished then.
+		GLsync fence = nullptr;
+	};
+
+	void run();
+	// Publishes batch after fencing it, requires loader context bound.
+	void publish(Batch batch);
+	[[nodiscard]] bool isCurrent(size_t generation) const;
+
+private:
+	QOffscreenSurface surface_;
+	std::unique_ptr<QOpenGLContext> context_;
+	std::unique_ptr<QThread> thread_;
+	bool fences_ = false;
+
+	mutable QMutex mutex_;
+	QWaitCondition requested_;
+	QString path_;
+	size_t generation_ = 0;
+	size_t loading_ = 0;
+	bool stop_ = false;
+	std::deque<Batch> batches_;
+
+	// Generation of the scene last handed to the render thread.
+	size_t sceneGeneration_ = 0;
+};
+
+}// namespace fgl
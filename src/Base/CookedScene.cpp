@@ -0,0 +1,125 @@
+#include "CookedScene.hpp"
+
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+size_t indexSize(const GLenum type)
+{
+	return type == GL_UNSIGNED_BYTE ? 1 : (type == GL_UNSIGNED_SHORT ? 2 : 4);
+}
+
+uint32_t readIndex(const std::byte * data, const GLenum type, const size_t i)
+{
+	switch (type)
+	{
+		case GL_UNSIGNED_BYTE:
+			return static_cast<uint32_t>(data[i]);
+		case GL_UNSIGNED_SHORT:
+		{
+			uint16_t index = 0;
+			std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+			return index;
+		}
+		default:
+		{
+			uint32_t index = 0;
+			std::memcpy(&index, data + i * sizeof(index), sizeof(index));
+			return index;
+		}
+	}
+}
+
+}// namespace
+
+uint32_t CookedScene::addView(const QOpenGLBuffer::Type type, std::vector<std::byte> data)
+{
+	if (!generated)
+	{
+		generated = std::make_shared<Generated>();
+		generated->source = std::move(owner);
+		owner = generated;
+	}
+	// Moving blocks keeps their storage, so earlier spans stay valid.
+	const auto & block = generated->blocks.emplace_back(std::move(data));
+	views.push_back({type, {block.data(), block.size()}});
+	return static_cast<uint32_t>(views.size() - 1);
+}
+
+std::vector<uint32_t> CookedScene::indices(const Primitive & primitive) const
+{
+	std::vector<uint32_t> indices(static_cast<size_t>(std::max(primitive.count, 0)));
+	if (!primitive.indexType)
+	{
+		std::iota(indices.begin(), indices.end(), 0u);
+		return indices;
+	}
+	if (primitive.indexView < 0 || static_cast<size_t>(primitive.indexView) >= views.size())
+	{
+		return {};
+	}
+
+	const auto & data = views[static_cast<size_t>(primitive.indexView)].data;
+	if (primitive.indexOffset + indices.size() * indexSize(primitive.indexType) > data.size())
+	{
+		return {};
+	}
+	for (size_t i = 0; i < indices.size(); ++i)
+	{
+		indices[i] = readIndex(data.data() + primitive.indexOffset, primitive.indexType, i);
+	}
+	return indices;
+}
+
+std::vector<uint32_t> CookedScene::triangleIndices(const Primitive & primitive) const
+{
+	if (primitive.mode != GL_TRIANGLES)
+	{
+		return {};
+	}
+	auto result = indices(primitive);
+	result.resize(result.size() / 3 * 3);
+	return result;
+}
+
+std::vector<QVector3D> CookedScene::positions(const Primitive & primitive, const size_t count) const
+{
+	const auto * begin = attributes.data() + primitive.firstAttribute;
+	const auto * end = begin + primitive.attributeCount;
+	const auto * position = std::find_if(begin, end, [](const auto & attribute) { return attribute.location == Attribute::Position; });
+	if (position == end || position->size < 3 || position->size > 4)
+	{
+		return {};
+	}
+
+	const auto size = componentSize(position->type) * static_cast<size_t>(position->size);
+	const auto & data = views[position->view].data;
+	const auto stride = position->stride ? static_cast<size_t>(position->stride) : size;
+	if (count && position->offset + (count - 1) * stride + size > data.size())
+	{
+		return {};
+	}
+
+	const auto & scale = primitive.dequantizeScale;
+	const auto & offset = primitive.dequantizeOffset;
+	std::vector<QVector3D> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; ++i)
+	{
+		std::array<float, 4> value{};
+		readComponents(position->type, position->normalized, position->size, data.data() + position->offset + i * stride, value.data());
+		result.emplace_back(value[0] * scale[0] + offset[0], value[1] * scale[1] + offset[1], value[2] * scale[2] + offset[2]);
+	}
+	return result;
+}
+
+}// namespace fgl
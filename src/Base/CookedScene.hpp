@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <QOpenGLBuffer>
+
+#include <gsl/span>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// CPU side description of a scene with vertex and index data already in the
+// final GPU layout. Produced from glTF by GltfLoader::cook() or read from
+// MeshCache, byte spans point into memory kept alive by owner.
+struct CookedScene {
+	using Bytes = gsl::span<const std::byte>;
+
+	struct BufferView {
+		QOpenGLBuffer::Type type = QOpenGLBuffer::VertexBuffer;
+		Bytes data;
+	};
+
+	struct VertexAttribute {
+		Attribute location = Attribute::Position;
+		uint32_t view = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		bool normalized = false;
+		GLsizei stride = 0;
+		size_t offset = 0;
+	};
+
+	struct Primitive {
+		GLenum mode = GL_TRIANGLES;
+		GLsizei count = 0;
+		// Zero for non-indexed primitives.
+		GLenum indexType = 0;
+		int32_t indexView = -1;
+		size_t indexOffset = 0;
+		int32_t material = -1;
+		Bounds bounds;
+		// Range in attributes, all of one interleaved view once optimized.
+		uint32_t firstAttribute = 0;
+		uint32_t attributeCount = 0;
+		// Vertices after the lowest attribute offset, zero if not optimized.
+		uint32_t vertexCount = 0;
+		// See fgl::Primitive::dequantizeScale.
+		std::array<float, 4> dequantizeScale{1.0f, 1.0f, 1.0f, 1.0f};
+		std::array<float, 4> dequantizeOffset{};
+		// Range in lods, levels share the index view and type of the primitive.
+		uint32_t firstLod = 0;
+		uint32_t lodCount = 0;
+	};
+
+	// Data produced while cooking, views over it are kept alive by owner.
+	struct Generated {
+		std::shared_ptr<const void> source;
+		std::vector<std::vector<std::byte>> blocks;
+	};
+
+	struct Mesh {
+		// Range in primitives.
+		uint32_t firstPrimitive = 0;
+		uint32_t primitiveCount = 0;
+	};
+
+	std::vector<BufferView> views;
+	// Encoded images, decoded by ImageDecoder.
+	std::vector<Bytes> images;
+	std::vector<Material> materials;
+	std::vector<VertexAttribute> attributes;
+	std::vector<Primitive> primitives;
+	std::vector<Lod> lods;
+	std::vector<Mesh> meshes;
+	std::vector<Node> nodes;
+
+	std::shared_ptr<const void> owner;
+	// Created by the first addView(), owner is pointed to it then.
+	std::shared_ptr<Generated> generated;
+
+	// Appends a view over data produced while cooking.
+	uint32_t addView(QOpenGLBuffer::Type type, std::vector<std::byte> data);
+
+	// Indices of a primitive, generated for non-indexed ones. Empty for
+	// indices outside of their view.
+	[[nodiscard]] std::vector<uint32_t> indices(const Primitive & primitive) const;
+	// Indices of whole triangles of a triangle list, empty for other modes.
+	[[nodiscard]] std::vector<uint32_t> triangleIndices(const Primitive & primitive) const;
+	// First count positions of a primitive, dequantized. Empty when they are
+	// outside of their view.
+	[[nodiscard]] std::vector<QVector3D> positions(const Primitive & primitive, size_t count) const;
+};
+
+}// namespace fgl
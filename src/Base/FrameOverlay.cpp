@@ -0,0 +1,291 @@
+#include "FrameOverlay.hpp"
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QImage>
+#include <QPainter>
+#include <QStringList>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr auto g_vertexShader = R"(#version 330 core
+layout(location = 0) in vec2 pos;
+layout(location = 1) in vec2 tex;
+layout(location = 2) in vec4 color;
+
+uniform vec2 viewport;
+
+out vec2 vert_tex;
+out vec4 vert_color;
+
+void main() {
+	vert_tex = tex;
+	vert_color = color;
+	gl_Position = vec4(pos / viewport * vec2(2.0, -2.0) + vec2(-1.0, 1.0), 0.0, 1.0);
+}
+)";
+
+// Negative texture coordinates mark solid rectangles.
+constexpr auto g_fragmentShader = R"(#version 330 core
+in vec2 vert_tex;
+in vec4 vert_color;
+
+uniform sampler2D text;
+
+out vec4 out_col;
+
+void main() {
+	out_col = vert_color * (vert_tex.x < 0.0 ? vec4(1.0) : texture(text, vert_tex));
+}
+)";
+
+// Text panel, bars and a full graph fit without growing the stream.
+constexpr size_t g_initialVertices = 2048;
+constexpr int g_margin = 8;
+constexpr int g_fontSize = 12;
+constexpr float g_barPixelsPerMs = 12.0f;
+constexpr float g_barMaxWidth = 300.0f;
+constexpr float g_graphHeight = 100.0f;
+// Graph spans two 60 Hz frames.
+constexpr float g_graphMaxMs = 1000.0f / 30.0f;
+constexpr float g_targetMs = 1000.0f / 60.0f;
+
+constexpr quint32 rgba(const quint32 r, const quint32 g, const quint32 b, const quint32 a)
+{
+	return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+constexpr auto g_background = rgba(0, 0, 0, 160);
+constexpr auto g_white = rgba(255, 255, 255, 255);
+constexpr auto g_cpuColor = rgba(90, 170, 255, 220);
+constexpr auto g_gpuColor = rgba(255, 150, 60, 220);
+constexpr auto g_targetColor = rgba(255, 255, 255, 90);
+
+quint32 frameColor(const float ms)
+{
+	if (ms <= g_targetMs)
+	{
+		return rgba(80, 220, 100, 230);
+	}
+	return ms <= g_graphMaxMs ? rgba(240, 210, 60, 230) : rgba(240, 70, 60, 230);
+}
+
+}// namespace
+
+FrameOverlay::FrameOverlay(const size_t graphFrames)
+	: graphFrames_{graphFrames}
+{
+}
+
+void FrameOverlay::initialize()
+{
+	initializeOpenGLFunctions();
+
+	program_ = std::make_unique<QOpenGLShaderProgram>();
+	program_->addShaderFromSourceCode(QOpenGLShader::Vertex, g_vertexShader);
+	program_->addShaderFromSourceCode(QOpenGLShader::Fragment, g_fragmentShader);
+	program_->link();
+	viewportUniform_ = program_->uniformLocation("viewport");
+	textureUniform_ = program_->uniformLocation("text");
+
+	vertexStream_.initialize(g_initialVertices * sizeof(Vertex));
+	vao_.create();
+	vao_.bind();
+	glBindBuffer(GL_ARRAY_BUFFER, vertexStream_.buffer());
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, x)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, u)));
+	glEnableVertexAttribArray(2);
+	glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex), reinterpret_cast<const void *>(offsetof(Vertex, color)));
+	vao_.release();
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void FrameOverlay::release()
+{
+	text_.reset();
+	vertexStream_.release();
+	vao_.destroy();
+	program_.reset();
+}
+
+void FrameOverlay::update(const FrameProfiler::Report & report, const DrawCounters & counters)
+{
+	QStringList lines;
+	lines << QString("Frame ms p50/p95/p99: %1 / %2 / %3")
+				 .arg(report.frame.p50, 0, 'f', 2)
+				 .arg(report.frame.p95, 0, 'f', 2)
+				 .arg(report.frame.p99, 0, 'f', 2);
+	lines << QString("Draws: %1  Triangles: %2").arg(counters.drawCalls).arg(counters.triangles);
+	lines << QString("Binds program/VAO/texture: %1 / %2 / %3  Uploads: %4")
+				 .arg(counters.programBinds)
+				 .arg(counters.vertexArrayBinds)
+				 .arg(counters.textureBinds)
+				 .arg(counters.bufferUploads);
+
+	// Phase lines show medians, bars next to them show the same values.
+	firstBarLine_ = static_cast<int>(lines.size());
+	bars_.clear();
+	for (const auto & phase: report.phases)
+	{
+		auto line = QString(static_cast<int>(phase.depth) * 2, ' ') + QString::fromStdString(phase.name);
+		line += QString("  cpu %1").arg(phase.cpu.p50, 0, 'f', 2);
+		if (phase.hasGpu)
+		{
+			line += QString("  gpu %1").arg(phase.gpu.p50, 0, 'f', 2);
+		}
+		lines << line;
+		bars_.push_back({phase.cpu.p50, phase.gpu.p50, phase.hasGpu});
+	}
+
+	QFont font("monospace");
+	font.setStyleHint(QFont::TypeWriter);
+	font.setPixelSize(g_fontSize);
+	const QFontMetrics metrics(font);
+	lineHeight_ = metrics.lineSpacing();
+
+	textWidth_ = 0;
+	for (const auto & line: lines)
+	{
+		textWidth_ = std::max(textWidth_, metrics.horizontalAdvance(line));
+	}
+	textWidth_ += 2 * g_margin;
+	textHeight_ = static_cast<int>(lines.size()) * lineHeight_ + g_margin;
+
+	QImage image(textWidth_, textHeight_, QImage::Format_RGBA8888);
+	image.fill(QColor(0, 0, 0, 160));
+	{
+		QPainter painter(&image);
+		painter.setFont(font);
+		painter.setPen(Qt::white);
+		for (int i = 0; i < static_cast<int>(lines.size()); ++i)
+		{
+			painter.drawText(g_margin, g_margin / 2 + i * lineHeight_ + metrics.ascent(), lines[i]);
+		}
+	}
+
+	text_ = std::make_unique<QOpenGLTexture>(image, QOpenGLTexture::DontGenerateMipMaps);
+	text_->setMinMagFilters(QOpenGLTexture::Nearest, QOpenGLTexture::Nearest);
+	text_->setWrapMode(QOpenGLTexture::ClampToEdge);
+}
+
+void FrameOverlay::render(const FrameProfiler::History & frameTimes, const int width, const int height)
+{
+	vertices_.clear();
+
+	// Text panel and phase bars.
+	const auto left = static_cast<float>(g_margin);
+	auto top = static_cast<float>(g_margin);
+	if (text_)
+	{
+		addRect(left, top, static_cast<float>(textWidth_), static_cast<float>(textHeight_), g_white, 0.0f, 0.0f, 1.0f, 1.0f);
+
+		const auto barLeft = left + static_cast<float>(textWidth_);
+		const auto barHeight = static_cast<float>(lineHeight_) / 2.0f;
+		for (size_t i = 0; i < bars_.size(); ++i)
+		{
+			const auto y = top + static_cast<float>(g_margin / 2 + (firstBarLine_ + static_cast<int>(i)) * lineHeight_);
+			const auto cpu = std::min(bars_[i].cpu * g_barPixelsPerMs, g_barMaxWidth);
+			addRect(barLeft, y, cpu, barHeight - 1.0f, g_cpuColor);
+			if (bars_[i].hasGpu)
+			{
+				const auto gpu = std::min(bars_[i].gpu * g_barPixelsPerMs, g_barMaxWidth);
+				addRect(barLeft, y + barHeight, gpu, barHeight - 1.0f, g_gpuColor);
+			}
+		}
+		top += static_cast<float>(textHeight_ + g_margin);
+	}
+
+	// Frame time graph, one pixel wide column per frame, newest on the right.
+	const auto values = frameTimes.values();
+	const auto count = std::min(values.size(), graphFrames_);
+	const auto graphWidth = static_cast<float>(graphFrames_);
+	addRect(left, top, graphWidth, g_graphHeight, g_background);
+	for (size_t i = 0; i < count; ++i)
+	{
+		const auto ms = values[values.size() - count + i];
+		const auto barHeight = std::min(ms / g_graphMaxMs, 1.0f) * g_graphHeight;
+		const auto x = left + graphWidth - static_cast<float>(count - i);
+		addRect(x, top + g_graphHeight - barHeight, 1.0f, barHeight, frameColor(ms));
+	}
+	addRect(left, top + g_graphHeight * (1.0f - g_targetMs / g_graphMaxMs), graphWidth, 1.0f, g_targetColor);
+
+	// Overlay is blended on top of everything.
+	const auto depthTest = glIsEnabled(GL_DEPTH_TEST);
+	const auto cullFace = glIsEnabled(GL_CULL_FACE);
+	const auto blend = glIsEnabled(GL_BLEND);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glEnable(GL_BLEND);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+	program_->bind();
+	program_->setUniformValue(viewportUniform_, static_cast<float>(width), static_cast<float>(height));
+	program_->setUniformValue(textureUniform_, 0);
+	glActiveTexture(GL_TEXTURE0);
+	if (text_)
+	{
+		text_->bind();
+	}
+
+	// Vertices go to this frame's partition, draws start at its first one.
+	const auto bytes = vertices_.size() * sizeof(Vertex);
+	vertexStream_.begin(bytes + sizeof(Vertex));
+	const auto allocation = vertexStream_.allocate(bytes, sizeof(Vertex));
+	if (allocation.data)
+	{
+		std::memcpy(allocation.data, vertices_.data(), bytes);
+	}
+	vertexStream_.finish();
+	if (allocation.data)
+	{
+		vao_.bind();
+		glDrawArrays(GL_TRIANGLES, static_cast<GLint>(allocation.offset / sizeof(Vertex)), static_cast<GLsizei>(vertices_.size()));
+		vao_.release();
+	}
+	vertexStream_.fence();
+
+	if (text_)
+	{
+		text_->release();
+	}
+	program_->release();
+
+	if (depthTest)
+	{
+		glEnable(GL_DEPTH_TEST);
+	}
+	if (cullFace)
+	{
+		glEnable(GL_CULL_FACE);
+	}
+	if (!blend)
+	{
+		glDisable(GL_BLEND);
+	}
+}
+
+void FrameOverlay::addRect(const float x, const float y, const float width, const float height, const quint32 color,
+						   const float u0, const float v0, const float u1, const float v1)
+{
+	// Solid rectangles get negative texture coordinates.
+	const auto solid = u0 == u1;
+	const auto left = solid ? -1.0f : u0;
+	const auto right = solid ? -1.0f : u1;
+	const Vertex topLeft{x, y, left, v0, color};
+	const Vertex topRight{x + width, y, right, v0, color};
+	const Vertex bottomLeft{x, y + height, left, v1, color};
+	const Vertex bottomRight{x + width, y + height, right, v1, color};
+	vertices_.insert(vertices_.end(), {topLeft, bottomLeft, bottomRight, topLeft, bottomRight, topRight});
+}
+
+}// namespace fgl
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "FrameProfiler.hpp"
+#include "InstrumentedFunctions.hpp"
+#include "StreamBuffer.hpp"
+
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// Frame statistics drawn with GL on top of the rendered frame: a rolling
+// graph of the last frame times, CPU/GPU bars per profiler phase and
+// counters. Graph is rebuilt every frame, text is rasterized into a texture
+// only by update(), so the overlay never repaints Qt widgets.
+class FrameOverlay final : protected QOpenGLFunctions
+{
+public:
+	explicit FrameOverlay(size_t graphFrames = 240);
+
+	FrameOverlay(const FrameOverlay &) = delete;
+	FrameOverlay(FrameOverlay &&) = delete;
+	FrameOverlay & operator=(const FrameOverlay &) = delete;
+	FrameOverlay & operator=(FrameOverlay &&) = delete;
+
+	// Both require a bound context.
+	void initialize();
+	void release();
+
+	// Refreshes text and phase bars, meant to be called a few times per
+	// second. Requires a bound context.
+	void update(const FrameProfiler::Report & report, const DrawCounters & counters);
+
+	// Draws over the bound framebuffer, restores the state it changes.
+	void render(const FrameProfiler::History & frameTimes, int width, int height);
+
+private:
+	struct Vertex {
+		float x = 0.0f;
+		float y = 0.0f;
+		float u = 0.0f;
+		float v = 0.0f;
+		quint32 color = 0;
+	};
+
+	void addRect(float x, float y, float width, float height, quint32 color, float u0 = 0.0f, float v0 = 0.0f,
+				 float u1 = 0.0f, float v1 = 0.0f);
+
+private:
+	size_t graphFrames_;
+
+	std::unique_ptr<QOpenGLShaderProgram> program_;
+	QOpenGLVertexArrayObject vao_;
+	StreamBuffer vertexStream_;
+	// Text rasterized by update().
+	std::unique_ptr<QOpenGLTexture> text_;
+	int textWidth_ = 0;
+	int textHeight_ = 0;
+
+	// Phase bars are placed next to their text lines.
+	struct Bar {
+		float cpu = 0.0f;
+		float gpu = 0.0f;
+		bool hasGpu = false;
+	};
+	std::vector<Bar> bars_;
+	int lineHeight_ = 0;
+	int firstBarLine_ = 0;
+
+	std::vector<Vertex> vertices_;
+
+	GLint viewportUniform_ = -1;
+	GLint textureUniform_ = -1;
+};
+
+}// namespace fgl
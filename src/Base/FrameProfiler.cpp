@@ -0,0 +1,373 @@
+#include "FrameProfiler.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <cmath>
+
+#ifndef GL_TIME_ELAPSED
+#define GL_TIME_ELAPSED 0x88BF
+#endif
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr auto g_nsInMs = 1000000.0f;
+
+float percentile(const std::vector<float> & sorted, const float fraction)
+{
+	if (sorted.empty())
+	{
+		return 0.0f;
+	}
+	// Nearest-rank percentile.
+	const auto rank = static_cast<size_t>(std::ceil(fraction * static_cast<float>(sorted.size())));
+	return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+}
+
+}// namespace
+
+FrameProfiler::History::History(const size_t capacity)
+	: values_(std::max<size_t>(capacity, 1), 0.0f)
+{
+}
+
+void FrameProfiler::History::push(const float value)
+{
+	values_[next_] = value;
+	next_ = (next_ + 1) % values_.size();
+	size_ = std::min(size_ + 1, values_.size());
+}
+
+void FrameProfiler::History::clear() noexcept
+{
+	next_ = 0;
+	size_ = 0;
+}
+
+size_t FrameProfiler::History::size() const noexcept
+{
+	return size_;
+}
+
+size_t FrameProfiler::History::capacity() const noexcept
+{
+	return values_.size();
+}
+
+float FrameProfiler::History::latest() const noexcept
+{
+	return size_ ? values_[(next_ + values_.size() - 1) % values_.size()] : 0.0f;
+}
+
+std::vector<float> FrameProfiler::History::values() const
+{
+	std::vector<float> result;
+	result.reserve(size_);
+	const auto first = (next_ + values_.size() - size_) % values_.size();
+	for (size_t i = 0; i < size_; ++i)
+	{
+		result.push_back(values_[(first + i) % values_.size()]);
+	}
+	return result;
+}
+
+auto FrameProfiler::History::percentiles() const -> Percentiles
+{
+	auto sorted = values();
+	std::sort(sorted.begin(), sorted.end());
+	return {percentile(sorted, 0.50f), percentile(sorted, 0.95f), percentile(sorted, 0.99f)};
+}
+
+FrameProfiler::Scope::Scope(FrameProfiler & self, const char * name, const Timing timing)
+	: self_{self}
+{
+	self_.beginPhase(name, timing);
+}
+
+FrameProfiler::Scope::~Scope()
+{
+	self_.endPhase();
+}
+
+FrameProfiler::FrameProfiler(const size_t historySize)
+	: historySize_{historySize}
+	, frameTimes_{historySize}
+{
+	clock_.start();
+}
+
+void FrameProfiler::initialize()
+{
+	initializeOpenGLFunctions();
+
+	// Timer queries are core since OpenGL 3.3.
+	const auto * context = QOpenGLContext::currentContext();
+	const auto format = context->format();
+	gpuSupported_ = !context->isOpenGLES()
+		&& (format.version() >= qMakePair(3, 3) || context->hasExtension("GL_ARB_timer_query"));
+}
+
+void FrameProfiler::release()
+{
+	for (auto & slot: slots_)
+	{
+		if (!slot.queries.empty())
+		{
+			glDeleteQueries(static_cast<GLsizei>(slot.queries.size()), slot.queries.data());
+		}
+		slot = FrameSlot{};
+	}
+	queryOpen_ = false;
+	gpuSupported_ = false;
+}
+
+void FrameProfiler::beginFrame()
+{
+	if (inFrame_)
+	{
+		endFrame();
+	}
+
+	const auto now = clock_.nsecsElapsed();
+	if (lastFrameBeginNs_ >= 0)
+	{
+		frameTimes_.push(static_cast<float>(now - lastFrameBeginNs_) / g_nsInMs);
+	}
+	lastFrameBeginNs_ = now;
+	inFrame_ = true;
+
+	// Results of this slot were issued frameLatency frames ago.
+	auto & slot = slots_[currentSlot_];
+	if (slot.pending)
+	{
+		resolve(slot);
+	}
+	slot.used = 0;
+}
+
+void FrameProfiler::endFrame()
+{
+	if (!inFrame_)
+	{
+		return;
+	}
+
+	while (!stack_.empty())
+	{
+		endPhase();
+	}
+
+	for (auto & phase: phases_)
+	{
+		if (phase.frameCpuNs >= 0)
+		{
+			phase.cpu.push(static_cast<float>(phase.frameCpuNs) / g_nsInMs);
+			phase.frameCpuNs = -1;
+		}
+	}
+
+	auto & slot = slots_[currentSlot_];
+	slot.pending = slot.used > 0;
+	currentSlot_ = (currentSlot_ + 1) % slots_.size();
+
+	++frames_;
+	inFrame_ = false;
+}
+
+void FrameProfiler::flush()
+{
+	for (auto & slot: slots_)
+	{
+		if (slot.pending)
+		{
+			resolve(slot);
+		}
+	}
+}
+
+void FrameProfiler::reset(const size_t historySize)
+{
+	historySize_ = historySize;
+	frameTimes_ = History{historySize_};
+	for (auto & phase: phases_)
+	{
+		phase.cpu = History{historySize_};
+		phase.gpu = History{historySize_};
+		phase.frameCpuNs = -1;
+	}
+	for (auto & counter: counters_)
+	{
+		counter.values = History{historySize_};
+	}
+	for (auto & slot: slots_)
+	{
+		slot.pending = false;
+	}
+	lastFrameBeginNs_ = -1;
+	frames_ = 0;
+}
+
+void FrameProfiler::beginPhase(const char * name, const Timing timing)
+{
+	const auto parent = stack_.empty() ? -1 : static_cast<int>(stack_.back().phase);
+	const auto phase = findPhase(name, parent);
+	const auto gpu = inFrame_ && gpuSupported_ && timing == Timing::CpuGpu;
+
+	stack_.push_back({phase, clock_.nsecsElapsed(), gpu});
+
+	if (gpu)
+	{
+		// Queries of the same type can not nest, so the parent one is split.
+		beginQuery(phase);
+	}
+}
+
+void FrameProfiler::endPhase()
+{
+	if (stack_.empty())
+	{
+		return;
+	}
+
+	const auto active = stack_.back();
+	stack_.pop_back();
+
+	auto & phase = phases_[active.phase];
+	phase.frameCpuNs = std::max<qint64>(phase.frameCpuNs, 0) + clock_.nsecsElapsed() - active.beginNs;
+
+	if (active.gpu)
+	{
+		endQuery();
+
+		// Resume timing of the nearest GPU timed parent.
+		const auto parent = std::find_if(stack_.rbegin(), stack_.rend(), [](const auto & item) { return item.gpu; });
+		if (parent != stack_.rend())
+		{
+			beginQuery(parent->phase);
+		}
+	}
+}
+
+auto FrameProfiler::scope(const char * name, const Timing timing) -> Scope
+{
+	return Scope{*this, name, timing};
+}
+
+void FrameProfiler::setCounter(const char * name, const float value)
+{
+	auto found = std::find_if(counters_.begin(), counters_.end(), [&](const auto & counter) { return counter.name == name; });
+	if (found == counters_.end())
+	{
+		found = counters_.insert(counters_.end(), {name, History{historySize_}});
+	}
+	found->values.push(value);
+}
+
+auto FrameProfiler::report() const -> Report
+{
+	Report result;
+	result.frames = frames_;
+	result.frame = frameTimes_.percentiles();
+	result.phases.reserve(phases_.size());
+	for (const auto & phase: phases_)
+	{
+		result.phases.push_back({phase.name, phase.depth, phase.cpu.percentiles(), phase.gpu.percentiles(), phase.gpu.size() > 0});
+	}
+	result.counters.reserve(counters_.size());
+	for (const auto & counter: counters_)
+	{
+		result.counters.push_back({counter.name, counter.values.percentiles()});
+	}
+	return result;
+}
+
+auto FrameProfiler::frameTimes() const noexcept -> const History &
+{
+	return frameTimes_;
+}
+
+bool FrameProfiler::gpuTimingSupported() const noexcept
+{
+	return gpuSupported_;
+}
+
+size_t FrameProfiler::findPhase(const char * name, const int parent)
+{
+	const auto found = std::find_if(phases_.begin(), phases_.end(), [&](const auto & phase) {
+		return phase.parent == parent && phase.name == name;
+	});
+	if (found != phases_.end())
+	{
+		return static_cast<size_t>(std::distance(phases_.begin(), found));
+	}
+
+	const auto depth = parent < 0 ? 0 : phases_[static_cast<size_t>(parent)].depth + 1;
+	phases_.push_back({name, parent, depth, History{historySize_}, History{historySize_}, -1});
+	return phases_.size() - 1;
+}
+
+void FrameProfiler::beginQuery(const size_t phase)
+{
+	if (queryOpen_)
+	{
+		endQuery();
+	}
+
+	auto & slot = slots_[currentSlot_];
+	if (slot.used == slot.queries.size())
+	{
+		GLuint query = 0;
+		glGenQueries(1, &query);
+		slot.queries.push_back(query);
+		slot.queryPhases.push_back(phase);
+	}
+	slot.queryPhases[slot.used] = phase;
+
+	glBeginQuery(GL_TIME_ELAPSED, slot.queries[slot.used]);
+	++slot.used;
+	queryOpen_ = true;
+}
+
+void FrameProfiler::endQuery()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	queryOpen_ = false;
+}
+
+void FrameProfiler::resolve(FrameSlot & slot)
+{
+	// Exclusive time of every phase, then children are folded into parents.
+	// Children are always registered after their parents.
+	std::vector<qint64> times(phases_.size(), -1);
+	for (size_t i = 0; i < slot.used; ++i)
+	{
+		// Blocks only if the GPU is more than frameLatency frames behind.
+		GLuint elapsed = 0;
+		glGetQueryObjectuiv(slot.queries[i], GL_QUERY_RESULT, &elapsed);
+		auto & time = times[slot.queryPhases[i]];
+		time = std::max<qint64>(time, 0) + elapsed;
+	}
+
+	for (auto i = phases_.size(); i-- > 0;)
+	{
+		const auto parent = phases_[i].parent;
+		if (times[i] < 0)
+		{
+			continue;
+		}
+		phases_[i].gpu.push(static_cast<float>(times[i]) / g_nsInMs);
+		if (parent >= 0)
+		{
+			auto & parentTime = times[static_cast<size_t>(parent)];
+			parentTime = std::max<qint64>(parentTime, 0) + times[i];
+		}
+	}
+
+	slot.pending = false;
+}
+
+}// namespace fgl
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QOpenGLExtraFunctions>
+
+#include <array>
+#include <string>
+#include <vector>
+
+namespace fgl
+{
+
+// Collects CPU and GPU timings of nested frame phases.
+// GPU timings use GL_TIME_ELAPSED queries which are read back
+// several frames later, so the render loop never waits for the GPU.
+class FrameProfiler final : protected QOpenGLExtraFunctions
+{
+public:
+	enum class Timing
+	{
+		CpuGpu,
+		CpuOnly,
+	};
+
+	// Frame times in milliseconds, or counter values.
+	struct Percentiles {
+		float p50 = 0.0f;
+		float p95 = 0.0f;
+		float p99 = 0.0f;
+	};
+
+	struct PhaseReport {
+		std::string name;
+		size_t depth = 0;
+		Percentiles cpu;
+		Percentiles gpu;
+		bool hasGpu = false;
+	};
+
+	struct CounterReport {
+		std::string name;
+		Percentiles values;
+	};
+
+	struct Report {
+		size_t frames = 0;
+		Percentiles frame;
+		std::vector<PhaseReport> phases;
+		std::vector<CounterReport> counters;
+	};
+
+	class History final
+	{
+	public:
+		explicit History(size_t capacity);
+
+		void push(float value);
+		void clear() noexcept;
+
+		[[nodiscard]] size_t size() const noexcept;
+		[[nodiscard]] size_t capacity() const noexcept;
+		[[nodiscard]] float latest() const noexcept;
+
+		// Values from the oldest to the newest one.
+		[[nodiscard]] std::vector<float> values() const;
+		[[nodiscard]] Percentiles percentiles() const;
+
+	private:
+		std::vector<float> values_;
+		size_t next_ = 0;
+		size_t size_ = 0;
+	};
+
+	class Scope final
+	{
+	public:
+		Scope(FrameProfiler & self, const char * name, Timing timing);
+		~Scope();
+
+		Scope(const Scope &) = delete;
+		Scope(Scope &&) = delete;
+		Scope & operator=(const Scope &) = delete;
+		Scope & operator=(Scope &&) = delete;
+
+	private:
+		FrameProfiler & self_;
+	};
+
+public:
+	explicit FrameProfiler(size_t historySize = 1024);
+
+	FrameProfiler(const FrameProfiler &) = delete;
+	FrameProfiler(FrameProfiler &&) = delete;
+	FrameProfiler & operator=(const FrameProfiler &) = delete;
+	FrameProfiler & operator=(FrameProfiler &&) = delete;
+
+	// Both require a bound context.
+	void initialize();
+	void release();
+
+	void beginFrame();
+	void endFrame();
+
+	// Waits for all issued GPU queries, requires a bound context.
+	void flush();
+	// Drops collected timings, phases and queries are kept.
+	void reset(size_t historySize);
+
+	void beginPhase(const char * name, Timing timing = Timing::CpuGpu);
+	void endPhase();
+
+	[[nodiscard]] Scope scope(const char * name, Timing timing = Timing::CpuGpu);
+
+	// Records a per frame value like a number of draw calls.
+	void setCounter(const char * name, float value);
+
+	[[nodiscard]] Report report() const;
+	[[nodiscard]] const History & frameTimes() const noexcept;
+	[[nodiscard]] bool gpuTimingSupported() const noexcept;
+
+private:
+	struct Phase {
+		std::string name;
+		int parent = -1;
+		size_t depth = 0;
+		History cpu;
+		History gpu;
+		qint64 frameCpuNs = -1;
+	};
+
+	struct Counter {
+		std::string name;
+		History values;
+	};
+
+	struct ActivePhase {
+		size_t phase = 0;
+		qint64 beginNs = 0;
+		bool gpu = false;
+	};
+
+	struct FrameSlot {
+		std::vector<GLuint> queries;
+		std::vector<size_t> queryPhases;
+		size_t used = 0;
+		bool pending = false;
+	};
+
+	// Number of frames GPU results may lag behind.
+	static constexpr size_t frameLatency = 4;
+
+	size_t findPhase(const char * name, int parent);
+	void beginQuery(size_t phase);
+	void endQuery();
+	void resolve(FrameSlot & slot);
+
+private:
+	size_t historySize_;
+	bool gpuSupported_ = false;
+	bool inFrame_ = false;
+	bool queryOpen_ = false;
+
+	QElapsedTimer clock_;
+	qint64 lastFrameBeginNs_ = -1;
+	History frameTimes_;
+	size_t frames_ = 0;
+
+	std::vector<Phase> phases_;
+	std::vector<ActivePhase> stack_;
+	std::vector<Counter> counters_;
+
+	std::array<FrameSlot, frameLatency> slots_;
+	size_t currentSlot_ = 0;
+};
+
+}// namespace fgl
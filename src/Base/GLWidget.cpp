@@ -3,6 +3,22 @@
 namespace fgl
 {
 
+GLWidget::GLWidget(QWidget * parent)
+	: QOpenGLWidget{parent}
+{
+	// Composition and swap happen after paintGL returns.
+	connect(this, &QOpenGLWidget::frameSwapped, [this] {
+		profiler_.endPhase();
+		profiler_.endFrame();
+	});
+}
+
+GLWidget::~GLWidget()
+{
+	const auto guard = bindContext();
+	profiler_.release();
+}
+
 GLWidget::ContextGuard::ContextGuard(GLWidget & self)
 	: self_{self}
 {
@@ -19,9 +35,30 @@ auto GLWidget::bindContext() noexcept -> ContextGuard
 	return ContextGuard{*this};
 }
 
-void GLWidget::initializeGL()
+bool GLWidget::isLoading() const
+{
+	return false;
+}
+
+FrameProfiler & GLWidget::profiler() noexcept
+{
+	return profiler_;
+}
+
+const DrawCounters & GLWidget::drawCounters() const noexcept
+{
+	return lastCounters_;
+}
+
+void GLWidget::initializeFunctions()
 {
 	initializeOpenGLFunctions();
+	profiler_.initialize();
+}
+
+void GLWidget::initializeGL()
+{
+	initializeFunctions();
 
 	{
 		const auto guard = bindContext();
@@ -38,7 +75,24 @@ void GLWidget::resizeGL(const int width, const int height)
 
 void GLWidget::paintGL()
 {
+	profiler_.beginFrame();
+	render();
+	profiler_.beginPhase("swap", FrameProfiler::Timing::CpuOnly);
+}
+
+void GLWidget::render()
+{
+	resetCounters();
 	onRender();
+	lastCounters_ = counters();
+
+	profiler_.setCounter("draw calls", static_cast<float>(lastCounters_.drawCalls));
+	profiler_.setCounter("triangles", static_cast<float>(lastCounters_.triangles));
+	profiler_.setCounter("program binds", static_cast<float>(lastCounters_.programBinds));
+	profiler_.setCounter("vertex array binds", static_cast<float>(lastCounters_.vertexArrayBinds));
+	profiler_.setCounter("texture binds", static_cast<float>(lastCounters_.textureBinds));
+	profiler_.setCounter("buffer uploads", static_cast<float>(lastCounters_.bufferUploads));
+	profiler_.setCounter("uploaded bytes", static_cast<float>(lastCounters_.uploadedBytes));
 }
 
 }// namespace fgl
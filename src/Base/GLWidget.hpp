@@ -1,24 +1,28 @@
 #pragma once
 
-#include <QOpenGLFunctions>
+#include "FrameProfiler.hpp"
+#include "InstrumentedFunctions.hpp"
+
 #include <QOpenGLWidget>
 
 namespace fgl
 {
 
 class GLWidget : public QOpenGLWidget
-	, protected QOpenGLFunctions
+	, protected InstrumentedFunctions
 {
 	Q_OBJECT
 
 public:
-	using QOpenGLWidget::QOpenGLWidget;
-	virtual ~GLWidget() = default;
+	explicit GLWidget(QWidget * parent = nullptr);
+	~GLWidget() override;
 
 public:
 	virtual void onInit() = 0;
 	virtual void onRender() = 0;
 	virtual void onResize(size_t width, size_t height) = 0;
+	// Widgets streaming their assets report it, so benchmarks wait for them.
+	[[nodiscard]] virtual bool isLoading() const;
 
 public:
 	class ContextGuard final
@@ -38,10 +42,25 @@ public:
 
 	[[nodiscard]] ContextGuard bindContext() noexcept;
 
+	[[nodiscard]] FrameProfiler & profiler() noexcept;
+	// Calls issued by the last onRender().
+	[[nodiscard]] const DrawCounters & drawCounters() const noexcept;
+
+private:
+	friend class OffscreenRunner;
+
+	void initializeFunctions();
+	// Calls onRender() and records its counters into the profiler.
+	void render();
+
 private:// QOpenGLWidget
 	void initializeGL() override;
 	void resizeGL(int width, int height) override;
 	void paintGL() override;
+
+private:
+	FrameProfiler profiler_;
+	DrawCounters lastCounters_;
 };
 
 }// namespace fgl
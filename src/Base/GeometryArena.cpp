@@ -0,0 +1,201 @@
+#include "GeometryArena.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Smallest buffer, in bytes.
+constexpr size_t g_minCapacity = 64 * 1024;
+// First indices of both index types are whole numbers.
+constexpr size_t g_indexAlignment = sizeof(uint32_t);
+
+}// namespace
+
+GeometryArena::GeometryArena(const GLuint instanceAttribute)
+	: instanceAttribute_{instanceAttribute}
+{
+}
+
+GeometryArena::~GeometryArena()
+{
+	if (pools_.empty() && !indexBuffer_ && !instanceBuffer_)
+	{
+		return;
+	}
+	initializeOpenGLFunctions();
+	for (auto & pool: pools_)
+	{
+		pool.vao.reset();
+		glDeleteBuffers(1, &pool.buffer);
+	}
+	glDeleteBuffers(1, &indexBuffer_);
+	glDeleteBuffers(1, &instanceBuffer_);
+}
+
+GeometryArena::Range GeometryArena::add(const Layout & layout, const Bytes vertices, const GLsizei vertexCount, const Bytes indices)
+{
+	initializeOpenGLFunctions();
+	Range range;
+	auto pool = std::find_if(pools_.begin(), pools_.end(), [&](const auto & pool) { return pool.layout == layout; });
+	if (pool == pools_.end())
+	{
+		pools_.emplace_back().layout = layout;
+		pool = std::prev(pools_.end());
+	}
+	range.pool = static_cast<uint32_t>(pool - pools_.begin());
+	range.vertexCount = vertexCount;
+
+	const auto stride = static_cast<size_t>(layout.stride);
+	const auto buffer = pool->buffer;
+	const auto vertex = allocate(pool->buffer, pool->vertices, stride, static_cast<size_t>(vertexCount), 1);
+	pool->changed = pool->changed || pool->buffer != buffer;
+	range.baseVertex = static_cast<GLint>(vertex);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, pool->buffer);
+	glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(vertex * stride), static_cast<GLsizeiptr>(vertices.size()), vertices.data());
+
+	if (!indices.empty())
+	{
+		const auto indexBuffer = indexBuffer_;
+		range.indexOffset = allocate(indexBuffer_, indices_, 1, indices.size(), g_indexAlignment);
+		range.indexSize = indices.size();
+		if (indexBuffer_ != indexBuffer)
+		{
+			// Every vertex array binds the index buffer.
+			for (auto & other: pools_)
+			{
+				other.changed = true;
+			}
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, indexBuffer_);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(range.indexOffset), static_cast<GLsizeiptr>(indices.size()), indices.data());
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	return range;
+}
+
+void GeometryArena::remove(const Range & range)
+{
+	if (range.pool < pools_.size())
+	{
+		pools_[range.pool].vertices.free(static_cast<size_t>(range.baseVertex), static_cast<size_t>(range.vertexCount));
+	}
+	indices_.free(range.indexOffset, range.indexSize);
+}
+
+void GeometryArena::reserveInstances(const size_t count)
+{
+	if (count <= instanceCount_)
+	{
+		return;
+	}
+	initializeOpenGLFunctions();
+	instanceCount_ = std::max(count, instanceCount_ * 2);
+	std::vector<GLuint> values(instanceCount_);
+	std::iota(values.begin(), values.end(), 0u);
+	if (!instanceBuffer_)
+	{
+		glGenBuffers(1, &instanceBuffer_);
+		for (auto & pool: pools_)
+		{
+			pool.changed = true;
+		}
+	}
+	// Storage is respecified in place, vertex arrays keep referencing the buffer.
+	glBindBuffer(GL_COPY_WRITE_BUFFER, instanceBuffer_);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(values.size() * sizeof(GLuint)), values.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GeometryArena::updateVertexArrays()
+{
+	initializeOpenGLFunctions();
+	for (auto & pool: pools_)
+	{
+		if (!pool.changed)
+		{
+			continue;
+		}
+		if (!pool.vao)
+		{
+			pool.vao = std::make_unique<QOpenGLVertexArrayObject>();
+			pool.vao->create();
+		}
+		pool.vao->bind();
+
+		glBindBuffer(GL_ARRAY_BUFFER, pool.buffer);
+		for (const auto & element: pool.layout.elements)
+		{
+			glEnableVertexAttribArray(element.location);
+			glVertexAttribPointer(element.location, element.size, element.type, element.normalized ? GL_TRUE : GL_FALSE,
+								  pool.layout.stride, reinterpret_cast<const void *>(element.offset));
+		}
+		if (instanceBuffer_)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+			glEnableVertexAttribArray(instanceAttribute_);
+			glVertexAttribIPointer(instanceAttribute_, 1, GL_UNSIGNED_INT, 0, nullptr);
+			glVertexAttribDivisor(instanceAttribute_, 1);
+		}
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer_);
+
+		// Index buffer binding is a part of VAO state, release it after.
+		pool.vao->release();
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		pool.changed = false;
+	}
+}
+
+QOpenGLVertexArrayObject * GeometryArena::vertexArray(const uint32_t pool) const
+{
+	return pool < pools_.size() ? pools_[pool].vao.get() : nullptr;
+}
+
+GLuint GeometryArena::instanceBuffer() const noexcept
+{
+	return instanceBuffer_;
+}
+
+size_t GeometryArena::poolCount() const noexcept
+{
+	return pools_.size();
+}
+
+void GeometryArena::grow(GLuint & buffer, const size_t size, const size_t capacity)
+{
+	GLuint grown = 0;
+	glGenBuffers(1, &grown);
+	glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+	glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(capacity), nullptr, GL_STATIC_DRAW);
+	if (buffer)
+	{
+		glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+		glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, static_cast<GLsizeiptr>(size));
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+		// Vertex arrays still pointing to the old buffer keep it alive until updated.
+		glDeleteBuffers(1, &buffer);
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	buffer = grown;
+}
+
+size_t GeometryArena::allocate(GLuint & buffer, RangeAllocator & allocator, const size_t unit, const size_t size, const size_t alignment)
+{
+	auto offset = allocator.allocate(size, alignment);
+	if (offset == RangeAllocator::invalid)
+	{
+		// Doubling keeps copying amortized.
+		const auto capacity = std::max({allocator.capacity() * 2, allocator.capacity() + size + alignment, g_minCapacity / unit});
+		grow(buffer, allocator.capacity() * unit, capacity * unit);
+		allocator.grow(capacity);
+		offset = allocator.allocate(size, alignment);
+	}
+	return offset;
+}
+
+}// namespace fgl
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "RangeAllocator.hpp"
+
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLVertexArrayObject>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// Vertex and index data of many meshes in a few large buffers. Vertices are
+// grouped into pools by layout, every pool has one vertex array object with
+// attributes at the start of its buffer and all pools share the index
+// buffer. Meshes are addressed by base vertex and first index, so draws of
+// different meshes in a pool do not rebind vertex arrays. Ranges come from
+// free lists and full buffers grow by copying on the GPU.
+//
+// Per instance data is not stored in vertex arrays. Every vertex array reads
+// consecutive integers as the instance attribute instead, shaders fetch
+// instance data by it.
+class GeometryArena final : protected QOpenGLExtraFunctions
+{
+public:
+	using Bytes = gsl::span<const std::byte>;
+
+	struct Element {
+		GLuint location = 0;
+		GLint size = 0;
+		GLenum type = 0;
+		bool normalized = false;
+		// Offset in the vertex.
+		size_t offset = 0;
+
+		bool operator==(const Element &) const = default;
+	};
+
+	struct Layout {
+		std::vector<Element> elements;
+		GLsizei stride = 0;
+
+		bool operator==(const Layout &) const = default;
+	};
+
+	struct Range {
+		uint32_t pool = 0;
+		GLint baseVertex = 0;
+		GLsizei vertexCount = 0;
+		// Bytes in the index buffer.
+		size_t indexOffset = 0;
+		size_t indexSize = 0;
+	};
+
+	// Instance attribute values are read at instanceAttribute.
+	explicit GeometryArena(GLuint instanceAttribute);
+	// Requires a bound context if anything was added.
+	~GeometryArena();
+
+	GeometryArena(const GeometryArena &) = delete;
+	GeometryArena(GeometryArena &&) = delete;
+	GeometryArena & operator=(const GeometryArena &) = delete;
+	GeometryArena & operator=(GeometryArena &&) = delete;
+
+	// Copies vertices of layout and their indices into the arena, indices
+	// are relative to the range. Requires a bound context, a shared one is
+	// fine until updateVertexArrays().
+	[[nodiscard]] Range add(const Layout & layout, Bytes vertices, GLsizei vertexCount, Bytes indices);
+	// Returns ranges to the free lists.
+	void remove(const Range & range);
+	// Makes instance attribute values up to count available.
+	void reserveInstances(size_t count);
+
+	// Creates vertex arrays of new pools and updates ones whose buffers
+	// grew. Vertex arrays are not shared between contexts, so this has to be
+	// called in the one used for drawing after add() and before drawing.
+	void updateVertexArrays();
+
+	[[nodiscard]] QOpenGLVertexArrayObject * vertexArray(uint32_t pool) const;
+	// Buffer of the instance attribute values.
+	[[nodiscard]] GLuint instanceBuffer() const noexcept;
+	[[nodiscard]] size_t poolCount() const noexcept;
+
+private:
+	struct Pool {
+		Layout layout;
+		GLuint buffer = 0;
+		RangeAllocator vertices;
+		std::unique_ptr<QOpenGLVertexArrayObject> vao;
+		bool changed = true;
+	};
+
+	// Reallocates buffer with capacity bytes keeping size bytes of contents.
+	void grow(GLuint & buffer, size_t size, size_t capacity);
+	[[nodiscard]] size_t allocate(GLuint & buffer, RangeAllocator & allocator, size_t unit, size_t size, size_t alignment);
+
+private:
+	GLuint instanceAttribute_ = 0;
+	std::vector<Pool> pools_;
+	GLuint indexBuffer_ = 0;
+	RangeAllocator indices_;
+	GLuint instanceBuffer_ = 0;
+	size_t instanceCount_ = 0;
+};
+
+}// namespace fgl
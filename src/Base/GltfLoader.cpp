@@ -0,0 +1,498 @@
+#include "GltfLoader.hpp"
+
+#include "ImageDecoder.hpp"
+#include "MappedGltf.hpp"
+#include "MeshCache.hpp"
+#include "MeshOptimizer.hpp"
+#include "VertexFormat.hpp"
+
+#include <QDebug>
+#include <QQuaternion>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <limits>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr std::array<std::pair<const char *, Attribute>, 4> g_attributes = {{
+	{"POSITION", Attribute::Position},
+	{"NORMAL", Attribute::Normal},
+	{"TEXCOORD_0", Attribute::TexCoord},
+	{"COLOR_0", Attribute::Color},
+}};
+
+// Minification without mips keeps the glTF filters, everything else is
+// trilinear with anisotropy. Wrap modes are GL enums in glTF.
+SamplerPolicy samplerPolicy(const tinygltf::Sampler & sampler)
+{
+	SamplerPolicy policy;
+	if (sampler.minFilter == GL_NEAREST || sampler.minFilter == GL_LINEAR)
+	{
+		policy.filter = sampler.magFilter == GL_NEAREST ? SamplerPolicy::Filter::Nearest : SamplerPolicy::Filter::Bilinear;
+	}
+	policy.wrapS = static_cast<GLenum>(sampler.wrapS);
+	policy.wrapT = static_cast<GLenum>(sampler.wrapT);
+	return policy;
+}
+
+QMatrix4x4 localTransform(const tinygltf::Node & node)
+{
+	QMatrix4x4 result;
+	if (node.matrix.size() == 16)
+	{
+		// Both glTF and QMatrix4x4 storage are column-major.
+		auto * data = result.data();
+		for (size_t i = 0; i < 16; ++i)
+		{
+			data[i] = static_cast<float>(node.matrix[i]);
+		}
+		return result;
+	}
+	if (node.translation.size() == 3)
+	{
+		result.translate(QVector3D{static_cast<float>(node.translation[0]),
+								   static_cast<float>(node.translation[1]),
+								   static_cast<float>(node.translation[2])});
+	}
+	if (node.rotation.size() == 4)
+	{
+		result.rotate(QQuaternion{static_cast<float>(node.rotation[3]),
+								  static_cast<float>(node.rotation[0]),
+								  static_cast<float>(node.rotation[1]),
+								  static_cast<float>(node.rotation[2])});
+	}
+	if (node.scale.size() == 3)
+	{
+		result.scale(QVector3D{static_cast<float>(node.scale[0]),
+							   static_cast<float>(node.scale[1]),
+							   static_cast<float>(node.scale[2])});
+	}
+	return result;
+}
+
+Bounds accessorBounds(const tinygltf::Accessor & accessor)
+{
+	Bounds result;
+	if (accessor.minValues.size() >= 3 && accessor.maxValues.size() >= 3)
+	{
+		result.extend(QVector3D{static_cast<float>(accessor.minValues[0]),
+								static_cast<float>(accessor.minValues[1]),
+								static_cast<float>(accessor.minValues[2])});
+		result.extend(QVector3D{static_cast<float>(accessor.maxValues[0]),
+								static_cast<float>(accessor.maxValues[1]),
+								static_cast<float>(accessor.maxValues[2])});
+	}
+	return result;
+}
+
+// Sparse and zero initialized accessors have no buffer view and are not supported.
+bool hasView(const tinygltf::Model & model, const int accessor)
+{
+	return model.accessors[static_cast<size_t>(accessor)].bufferView >= 0;
+}
+
+size_t viewOf(const tinygltf::Model & model, const int accessor)
+{
+	return static_cast<size_t>(model.accessors[static_cast<size_t>(accessor)].bufferView);
+}
+
+// Meshes with more triangles are too expensive to rasterize as occluders.
+constexpr size_t g_maxOccluderTriangles = 4096;
+
+// Copies positions of triangle list primitives, others are skipped. Only the
+// referenced vertex range is copied.
+Occluder extractOccluder(const CookedScene & cooked, const CookedScene::Mesh & mesh)
+{
+	Occluder occluder;
+	for (uint32_t i = 0; i < mesh.primitiveCount; ++i)
+	{
+		const auto & primitive = cooked.primitives[mesh.firstPrimitive + i];
+		const auto indices = cooked.triangleIndices(primitive);
+		if (indices.empty())
+		{
+			continue;
+		}
+		if ((occluder.indices.size() + indices.size()) / 3 > g_maxOccluderTriangles)
+		{
+			return {};
+		}
+		const auto [first, last] = std::minmax_element(indices.begin(), indices.end());
+		const auto positions = cooked.positions(primitive, static_cast<size_t>(*last) + 1);
+		if (positions.empty())
+		{
+			continue;
+		}
+
+		const auto base = static_cast<uint32_t>(occluder.vertices.size());
+		occluder.vertices.insert(occluder.vertices.end(), positions.begin() + *first, positions.end());
+		for (const auto index: indices)
+		{
+			occluder.indices.push_back(base + index - *first);
+		}
+	}
+	return occluder;
+}
+
+// Copies vertices and indices of all levels of an optimized primitive into
+// the arena and points primitive to them. Fails for primitives without
+// vertices and ones reaching outside of their views.
+bool addGeometry(GeometryArena & arena, const CookedScene & cooked, const CookedScene::Primitive & source, Primitive & primitive)
+{
+	if (!source.count || !source.vertexCount || !source.attributeCount)
+	{
+		return false;
+	}
+
+	// Attributes are interleaved in one view, the layout is relative to the first vertex.
+	const auto attributes = gsl::span<const CookedScene::VertexAttribute>{cooked.attributes}.subspan(source.firstAttribute, source.attributeCount);
+	const auto view = attributes[0].view;
+	const auto stride = attributes[0].stride;
+	auto start = std::numeric_limits<size_t>::max();
+	for (const auto & attribute: attributes)
+	{
+		if (attribute.view != view || attribute.stride != stride)
+		{
+			return false;
+		}
+		start = std::min(start, attribute.offset);
+	}
+	GeometryArena::Layout layout;
+	layout.stride = stride;
+	for (const auto & attribute: attributes)
+	{
+		layout.elements.push_back({static_cast<GLuint>(attribute.location), attribute.size, attribute.type, attribute.normalized,
+								   attribute.offset - start});
+	}
+	const auto & vertexData = cooked.views[view].data;
+	const auto vertexSize = static_cast<size_t>(source.vertexCount) * static_cast<size_t>(stride);
+	if (stride <= 0 || start + vertexSize > vertexData.size())
+	{
+		return false;
+	}
+
+	// Levels follow the full list in its view.
+	CookedScene::Bytes indices;
+	if (source.indexType)
+	{
+		const auto size = componentSize(source.indexType);
+		auto end = source.indexOffset + size * static_cast<size_t>(source.count);
+		for (const auto & lod: primitive.lods)
+		{
+			if (lod.indexOffset < source.indexOffset)
+			{
+				return false;
+			}
+			end = std::max(end, lod.indexOffset + size * static_cast<size_t>(lod.count));
+		}
+		if (source.indexView < 0 || end > cooked.views[static_cast<size_t>(source.indexView)].data.size())
+		{
+			return false;
+		}
+		indices = cooked.views[static_cast<size_t>(source.indexView)].data.subspan(source.indexOffset, end - source.indexOffset);
+	}
+
+	primitive.geometry = arena.add(layout, vertexData.subspan(start, vertexSize), static_cast<GLsizei>(source.vertexCount), indices);
+	primitive.indexOffset = primitive.geometry.indexOffset;
+	for (auto & lod: primitive.lods)
+	{
+		lod.indexOffset = primitive.geometry.indexOffset + lod.indexOffset - source.indexOffset;
+	}
+	return true;
+}
+
+}// namespace
+
+GltfLoader::GltfLoader(MeshCache * cache)
+	: cache_{cache}
+{
+	initializeOpenGLFunctions();
+}
+
+void GltfLoader::setTextureUploader(TextureUploader * const uploader) noexcept
+{
+	uploader_ = uploader;
+}
+
+std::unique_ptr<Scene> GltfLoader::load(const QString & path, ImageDecoder * decoder)
+{
+	CookedScene cooked;
+	return cook(path, cooked) ? upload(cooked, decoder) : nullptr;
+}
+
+bool GltfLoader::cook(const QString & path, CookedScene & cooked)
+{
+	// Warm starts skip glTF parsing entirely.
+	QByteArray key;
+	if (cache_)
+	{
+		key = MeshCache::hash(path);
+		if (!key.isEmpty() && cache_->load(key, cooked))
+		{
+			return true;
+		}
+	}
+
+	auto asset = std::make_shared<MappedGltf>();
+	if (!asset->open(path, MappedGltf::ImageDecoding::Deferred))
+	{
+		error_ = asset->error();
+		return false;
+	}
+	cooked = cook(asset);
+	if (cache_ && !key.isEmpty() && !cache_->store(key, cooked))
+	{
+		qWarning() << "Failed to cache" << path << ":" << cache_->error();
+	}
+	return true;
+}
+
+CookedScene GltfLoader::cook(std::shared_ptr<const MappedGltf> asset)
+{
+	const auto & model = asset->model();
+	CookedScene cooked;
+
+	// Buffer views are typed by their usage in primitives.
+	std::vector<int> viewTypes(model.bufferViews.size(), 0);
+	for (const auto & mesh: model.meshes)
+	{
+		for (const auto & primitive: mesh.primitives)
+		{
+			if (primitive.indices >= 0 && hasView(model, primitive.indices))
+			{
+				viewTypes[viewOf(model, primitive.indices)] = QOpenGLBuffer::IndexBuffer;
+			}
+			for (const auto & [name, accessor]: primitive.attributes)
+			{
+				if (hasView(model, accessor))
+				{
+					auto & type = viewTypes[viewOf(model, accessor)];
+					type = type ? type : QOpenGLBuffer::VertexBuffer;
+				}
+			}
+		}
+	}
+
+	// Views are kept as spans into the mapping, unused ones stay empty.
+	for (size_t i = 0; i < model.bufferViews.size(); ++i)
+	{
+		auto & view = cooked.views.emplace_back();
+		if (viewTypes[i])
+		{
+			view.type = static_cast<QOpenGLBuffer::Type>(viewTypes[i]);
+			view.data = asset->bufferView(i);
+		}
+	}
+
+	for (size_t i = 0; i < model.images.size(); ++i)
+	{
+		cooked.images.push_back(asset->encodedImage(i));
+	}
+
+	for (const auto & source: model.materials)
+	{
+		const auto & pbr = source.pbrMetallicRoughness;
+		auto & material = cooked.materials.emplace_back();
+		for (int i = 0; i < 4 && i < static_cast<int>(pbr.baseColorFactor.size()); ++i)
+		{
+			material.baseColor[i] = static_cast<float>(pbr.baseColorFactor[static_cast<size_t>(i)]);
+		}
+		// Indices are not validated by tinygltf, materials with broken ones
+		// are left untextured.
+		if (pbr.baseColorTexture.index >= 0 && static_cast<size_t>(pbr.baseColorTexture.index) < model.textures.size())
+		{
+			const auto & texture = model.textures[static_cast<size_t>(pbr.baseColorTexture.index)];
+			material.baseColorTexture = texture.source >= 0 && static_cast<size_t>(texture.source) < model.images.size() ? texture.source : -1;
+			if (texture.sampler >= 0 && static_cast<size_t>(texture.sampler) < model.samplers.size())
+			{
+				material.sampler = samplerPolicy(model.samplers[static_cast<size_t>(texture.sampler)]);
+			}
+		}
+	}
+
+	for (const auto & source: model.meshes)
+	{
+		auto & mesh = cooked.meshes.emplace_back();
+		mesh.firstPrimitive = static_cast<uint32_t>(cooked.primitives.size());
+		for (const auto & sourcePrimitive: source.primitives)
+		{
+			const auto position = sourcePrimitive.attributes.find("POSITION");
+			if (position == sourcePrimitive.attributes.end() || !hasView(model, position->second)
+				|| (sourcePrimitive.indices >= 0 && !hasView(model, sourcePrimitive.indices)))
+			{
+				continue;
+			}
+
+			auto & primitive = cooked.primitives.emplace_back();
+			primitive.mode = sourcePrimitive.mode < 0 ? GL_TRIANGLES : static_cast<GLenum>(sourcePrimitive.mode);
+			primitive.material = sourcePrimitive.material;
+
+			const auto & positions = model.accessors[static_cast<size_t>(position->second)];
+			primitive.count = static_cast<GLsizei>(positions.count);
+			primitive.bounds = accessorBounds(positions);
+
+			primitive.firstAttribute = static_cast<uint32_t>(cooked.attributes.size());
+			for (const auto & [name, location]: g_attributes)
+			{
+				const auto found = sourcePrimitive.attributes.find(name);
+				if (found == sourcePrimitive.attributes.end() || !hasView(model, found->second))
+				{
+					continue;
+				}
+				const auto & accessor = model.accessors[static_cast<size_t>(found->second)];
+				const auto & view = model.bufferViews[static_cast<size_t>(accessor.bufferView)];
+				cooked.attributes.push_back({
+					location,
+					static_cast<uint32_t>(accessor.bufferView),
+					tinygltf::GetNumComponentsInType(static_cast<uint32_t>(accessor.type)),
+					static_cast<GLenum>(accessor.componentType),
+					accessor.normalized,
+					static_cast<GLsizei>(view.byteStride),
+					accessor.byteOffset,
+				});
+			}
+			primitive.attributeCount = static_cast<uint32_t>(cooked.attributes.size()) - primitive.firstAttribute;
+
+			if (sourcePrimitive.indices >= 0)
+			{
+				const auto & indices = model.accessors[static_cast<size_t>(sourcePrimitive.indices)];
+				primitive.count = static_cast<GLsizei>(indices.count);
+				primitive.indexType = static_cast<GLenum>(indices.componentType);
+				primitive.indexView = indices.bufferView;
+				primitive.indexOffset = indices.byteOffset;
+			}
+		}
+		mesh.primitiveCount = static_cast<uint32_t>(cooked.primitives.size()) - mesh.firstPrimitive;
+	}
+
+	// Flatten node hierarchy of the default scene.
+	const auto addNode = [&](const auto & self, const int index, const QMatrix4x4 & parent) -> void {
+		const auto & node = model.nodes[static_cast<size_t>(index)];
+		const auto world = parent * localTransform(node);
+		if (node.mesh >= 0)
+		{
+			cooked.nodes.push_back({world, static_cast<size_t>(node.mesh)});
+		}
+		for (const auto child: node.children)
+		{
+			self(self, child, world);
+		}
+	};
+	if (!model.scenes.empty())
+	{
+		const auto sceneIndex = static_cast<size_t>(std::max(model.defaultScene, 0));
+		for (const auto node: model.scenes[sceneIndex].nodes)
+		{
+			addNode(addNode, node, QMatrix4x4{});
+		}
+	}
+
+	cooked.owner = std::move(asset);
+	const auto optimization = optimizeMeshes(cooked);
+	if (optimization.before.triangles)
+	{
+		qInfo() << "Vertex cache ACMR" << optimization.before.acmr() << "->" << optimization.after.acmr() << "ATVR"
+				<< optimization.before.atvr() << "->" << optimization.after.atvr();
+	}
+	return cooked;
+}
+
+std::unique_ptr<Scene> GltfLoader::upload(const CookedScene & cooked, ImageDecoder * decoder)
+{
+	auto scene = uploadResources(cooked, decoder);
+	scene->geometry.updateVertexArrays();
+	return scene;
+}
+
+std::unique_ptr<Scene> GltfLoader::uploadResources(const CookedScene & cooked, ImageDecoder * decoder)
+{
+	auto scene = std::make_unique<Scene>();
+
+	// Textures are created per image, glTF textures only reference them.
+	// With a decoder images stay without texture until ImageDecoder uploads
+	// them.
+	if (decoder)
+	{
+		// Images of the previous scene are not needed anymore.
+		decoder->cancel();
+	}
+	scene->images.resize(cooked.images.size());
+	TexturePacker packer;
+	packer.setUploader(uploader_);
+	for (size_t i = 0; i < cooked.images.size(); ++i)
+	{
+		if (cooked.images[i].empty())
+		{
+			continue;
+		}
+		if (decoder)
+		{
+			decoder->decode(cooked.owner, cooked.images[i], i);
+		}
+		else if (auto image = decodeImage(cooked.images[i], i))
+		{
+			packer.add(i, std::move(image));
+		}
+	}
+	for (auto & texture: packer.upload(true))
+	{
+		scene->addTexture(std::move(texture));
+	}
+
+	scene->materials = cooked.materials;
+
+	for (const auto & source: cooked.meshes)
+	{
+		auto & mesh = scene->meshes.emplace_back();
+		for (uint32_t i = 0; i < source.primitiveCount; ++i)
+		{
+			const auto & cookedPrimitive = cooked.primitives[source.firstPrimitive + i];
+			auto & primitive = mesh.primitives.emplace_back();
+			primitive.mode = cookedPrimitive.mode;
+			primitive.count = cookedPrimitive.count;
+			primitive.indexType = cookedPrimitive.indexType;
+			primitive.material = cookedPrimitive.material;
+			primitive.bounds = cookedPrimitive.bounds;
+			primitive.dequantizeScale = cookedPrimitive.dequantizeScale;
+			primitive.dequantizeOffset = cookedPrimitive.dequantizeOffset;
+			const auto lods = cooked.lods.begin() + cookedPrimitive.firstLod;
+			primitive.lods.assign(lods, lods + cookedPrimitive.lodCount);
+			if (!addGeometry(scene->geometry, cooked, cookedPrimitive, primitive))
+			{
+				primitive.count = 0;
+				primitive.lods.clear();
+			}
+			mesh.bounds.extend(primitive.bounds);
+		}
+		mesh.occluder = extractOccluder(cooked, source);
+	}
+
+	for (const auto & node: cooked.nodes)
+	{
+		scene->nodes.push_back(node);
+		scene->bounds.extend(scene->meshes[node.mesh].bounds.transformed(node.world));
+	}
+
+	// Renderers write a record per visible instance of every primitive.
+	size_t instanceCount = 0;
+	for (const auto & node: scene->nodes)
+	{
+		instanceCount += scene->meshes[node.mesh].primitives.size();
+	}
+	scene->geometry.reserveInstances(instanceCount);
+
+	return scene;
+}
+
+const QString & GltfLoader::error() const noexcept
+{
+	return error_;
+}
+
+}// namespace fgl
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "CookedScene.hpp"
+#include "Scene.hpp"
+
+#include <QOpenGLExtraFunctions>
+#include <QString>
+
+#include <memory>
+
+namespace fgl
+{
+
+class ImageDecoder;
+class MappedGltf;
+class MeshCache;
+class TextureUploader;
+
+// Turns glTF models into GPU meshes. Vertices are repacked into quantized
+// interleaved layouts and reordered for vertex cache locality while
+// cooking, see optimizeMeshes(), and uploaded into the GeometryArena of the
+// scene. Nodes sharing a mesh become instances of it. With a cache cooked
+// scenes are stored on the first load and read back afterwards.
+class GltfLoader final : protected QOpenGLExtraFunctions
+{
+public:
+	// Requires a bound context.
+	explicit GltfLoader(MeshCache * cache = nullptr);
+
+	// Images decoded without a decoder are streamed by uploader, scene
+	// textures stay null until TextureUploader::upload() returns them.
+	void setTextureUploader(TextureUploader * uploader) noexcept;
+
+	// Loads .glb or .gltf file, Qt resource paths are supported.
+	// With a decoder images are decoded in background and scene textures
+	// stay null until the decoder uploads them.
+	[[nodiscard]] std::unique_ptr<Scene> load(const QString & path, ImageDecoder * decoder = nullptr);
+
+	// Describes asset in GPU layout without touching GL. Meshes are
+	// optimized and simplified levels of detail are generated here, so the
+	// results are cached too.
+	[[nodiscard]] bool cook(const QString & path, CookedScene & cooked);
+	[[nodiscard]] static CookedScene cook(std::shared_ptr<const MappedGltf> asset);
+
+	[[nodiscard]] std::unique_ptr<Scene> upload(const CookedScene & cooked, ImageDecoder * decoder = nullptr);
+	// Vertex array objects are not shared between contexts, so uploading can
+	// be split: buffers and textures may be created in a shared context and
+	// vertex arrays with GeometryArena::updateVertexArrays() in the one used
+	// for drawing.
+	[[nodiscard]] std::unique_ptr<Scene> uploadResources(const CookedScene & cooked, ImageDecoder * decoder = nullptr);
+
+	[[nodiscard]] const QString & error() const noexcept;
+
+private:
+	MeshCache * cache_ = nullptr;
+	TextureUploader * uploader_ = nullptr;
+	QString error_;
+};
+
+}// namespace fgl
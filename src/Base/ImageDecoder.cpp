@@ -0,0 +1,211 @@
+#include "ImageDecoder.hpp"
+
+#include "TextureCache.hpp"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+std::unique_ptr<tinygltf::Image> decodeImage(const gsl::span<const std::byte> bytes, const size_t index)
+{
+	auto image = std::make_unique<tinygltf::Image>();
+	std::string error;
+	std::string warning;
+	// Null user data requests RGBA8 output.
+	if (!tinygltf::LoadImageData(image.get(), static_cast<int>(index), &error, &warning, 0, 0,
+								 reinterpret_cast<const unsigned char *>(bytes.data()), static_cast<int>(bytes.size()), nullptr))
+	{
+		qWarning() << "Failed to decode image" << index << QString::fromStdString(error);
+		return nullptr;
+	}
+	return image;
+}
+
+ImageDecoder::ImageDecoder(const TextureCache * textureCache, const int threadCount)
+	: textureCache_{textureCache}
+{
+	pool_.setMaxThreadCount(std::max(threadCount, 1));
+}
+
+ImageDecoder::~ImageDecoder()
+{
+	cancel();
+}
+
+void ImageDecoder::setCompression(const bool enabled)
+{
+	compression_ = enabled && textureCache_;
+}
+
+void ImageDecoder::setVirtualSize(const int size)
+{
+	virtualSize_ = textureCache_ ? size : 0;
+}
+
+void ImageDecoder::decode(std::shared_ptr<const void> owner, const gsl::span<const std::byte> bytes, const size_t image)
+{
+	{
+		QMutexLocker lock(&mutex_);
+		++pending_;
+	}
+	// Owner is captured to keep the bytes alive.
+	pool_.start([this, owner = std::move(owner), bytes, image, compression = compression_, virtualSize = virtualSize_] {
+		auto decoded = decodeOrCompress(bytes, image, compression, virtualSize);
+
+		QMutexLocker lock(&mutex_);
+		--pending_;
+		if (decoded.image || !decoded.compressed.isEmpty() || !decoded.tiled.path.isEmpty())
+		{
+			finished_.push_back(std::move(decoded));
+		}
+		finishedCondition_.wakeAll();
+	});
+}
+
+bool ImageDecoder::Uploads::isEmpty() const noexcept
+{
+	return textures.empty() && tiled.empty();
+}
+
+auto ImageDecoder::uploadFinished() -> Uploads
+{
+	std::vector<Decoded> finished;
+	auto done = false;
+	{
+		QMutexLocker lock(&mutex_);
+		finished.swap(finished_);
+		done = pending_ == 0;
+	}
+
+	Uploads uploads;
+	for (auto & decoded: finished)
+	{
+		if (decoded.image)
+		{
+			packer_.add(decoded.index, std::move(decoded.image));
+		}
+		else if (!decoded.compressed.isEmpty())
+		{
+			packer_.add(decoded.index, std::move(decoded.compressed));
+		}
+		else
+		{
+			uploads.tiled.emplace_back(decoded.index, std::move(decoded.tiled));
+		}
+	}
+	// Nothing else can share arrays with small images once all are decoded.
+	uploads.textures = packer_.upload(done);
+	return uploads;
+}
+
+size_t ImageDecoder::uploadFinished(Scene & scene)
+{
+	auto uploads = uploadFinished();
+	for (auto & texture: uploads.textures)
+	{
+		scene.addTexture(std::move(texture));
+	}
+	for (auto & [index, tiled]: uploads.tiled)
+	{
+		scene.addTiled(index, std::move(tiled));
+	}
+	return uploads.textures.size() + uploads.tiled.size();
+}
+
+void ImageDecoder::wait()
+{
+	QMutexLocker lock(&mutex_);
+	while (finished_.empty() && pending_ > 0)
+	{
+		finishedCondition_.wait(&mutex_);
+	}
+}
+
+void ImageDecoder::cancel()
+{
+	pool_.clear();
+	pool_.waitForDone();
+
+	packer_.clear();
+	QMutexLocker lock(&mutex_);
+	finished_.clear();
+	pending_ = 0;
+	finishedCondition_.wakeAll();
+}
+
+auto ImageDecoder::decodeOrCompress(const gsl::span<const std::byte> bytes, const size_t image, const bool compression,
+									const int virtualSize) const -> Decoded
+{
+	Decoded decoded{image, nullptr, {}, {}};
+	if (!textureCache_)
+	{
+		decoded.image = decodeImage(bytes, image);
+		return decoded;
+	}
+
+	const auto key = TextureCache::hash(bytes);
+	const auto tiles = [&](const int width, const int height) { return virtualSize > 0 && std::max(width, height) > virtualSize; };
+	if (virtualSize > 0)
+	{
+		decoded.tiled = textureCache_->loadTiled(key);
+		if (!decoded.tiled.path.isEmpty())
+		{
+			return decoded;
+		}
+	}
+	if (compression && textureCache_->load(key, decoded.compressed))
+	{
+		const auto & base = decoded.compressed.levels.front();
+		if (!tiles(base.width, base.height))
+		{
+			return decoded;
+		}
+		decoded.compressed = {};
+	}
+
+	decoded.image = decodeImage(bytes, image);
+	if (!decoded.image)
+	{
+		return decoded;
+	}
+	if (tiles(decoded.image->width, decoded.image->height))
+	{
+		decoded.tiled = textureCache_->storeTiled(key, *decoded.image);
+		if (!decoded.tiled.path.isEmpty())
+		{
+			decoded.image.reset();
+			return decoded;
+		}
+	}
+	if (compression)
+	{
+		// Unsupported pixel formats are uploaded as they are.
+		decoded.compressed = compressTexture(*decoded.image);
+		if (!decoded.compressed.isEmpty())
+		{
+			textureCache_->store(key, decoded.compressed);
+			decoded.image.reset();
+		}
+	}
+	return decoded;
+}
+
+size_t ImageDecoder::pending() const
+{
+	QMutexLocker lock(&mutex_);
+	return pending_;
+}
+
+bool ImageDecoder::isIdle() const
+{
+	QMutexLocker lock(&mutex_);
+	return !pending_ && finished_.empty() && packer_.isEmpty();
+}
+
+}// namespace fgl
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "Scene.hpp"
+#include "TextureCompressor.hpp"
+#include "TexturePacker.hpp"
+
+#include <QMutex>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
+
+#include <gsl/span>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace tinygltf
+{
+struct Image;
+}// namespace tinygltf
+
+namespace fgl
+{
+
+class TextureCache;
+
+// Decodes PNG or JPEG image into RGBA8 pixels, returns null on failure.
+[[nodiscard]] std::unique_ptr<tinygltf::Image> decodeImage(gsl::span<const std::byte> bytes, size_t index);
+
+// Decodes glTF images on a thread pool. Decoded pixels are handed back to
+// the GL thread, which uploads whatever has finished since the last call,
+// so textures appear progressively instead of stalling the load. Small
+// images are held back until all are decoded to be packed into arrays.
+//
+// With a texture cache RGBA8 images can be block compressed with their mips
+// on the pool too, and large ones cut into tiles for a virtual texture.
+// Both are read from the cache when done before.
+class ImageDecoder final
+{
+public:
+	explicit ImageDecoder(const TextureCache * textureCache = nullptr, int threadCount = QThread::idealThreadCount());
+	~ImageDecoder();
+
+	ImageDecoder(const ImageDecoder &) = delete;
+	ImageDecoder(ImageDecoder &&) = delete;
+	ImageDecoder & operator=(const ImageDecoder &) = delete;
+	ImageDecoder & operator=(ImageDecoder &&) = delete;
+
+	// Both require a texture cache and apply to images queued after.
+	void setCompression(bool enabled);
+	// Images larger than size on either side are tiled instead of uploaded,
+	// zero disables tiling.
+	void setVirtualSize(int size);
+
+	// Queues decoding of encoded image bytes, owner of the bytes is kept
+	// alive until the image is decoded.
+	void decode(std::shared_ptr<const void> owner, gsl::span<const std::byte> bytes, size_t image);
+
+	struct Uploads {
+		std::vector<PackedTexture> textures;
+		// Tiled images by image index.
+		std::vector<std::pair<size_t, TiledImage>> tiled;
+
+		[[nodiscard]] bool isEmpty() const noexcept;
+	};
+
+	// Creates textures for finished images. Requires a bound context.
+	[[nodiscard]] Uploads uploadFinished();
+	// Same, but puts them into the scene and returns their number.
+	size_t uploadFinished(Scene & scene);
+
+	// Blocks until some image finishes or nothing is pending.
+	void wait();
+
+	// Drops queued and finished images, waits for running ones.
+	void cancel();
+
+	[[nodiscard]] size_t pending() const;
+	// Every queued image was uploaded.
+	[[nodiscard]] bool isIdle() const;
+
+private:
+	// One of pixels, compressed blocks or tiles is set.
+	struct Decoded {
+		size_t index = 0;
+		std::unique_ptr<tinygltf::Image> image;
+		CompressedTexture compressed;
+		TiledImage tiled;
+	};
+
+	[[nodiscard]] Decoded decodeOrCompress(gsl::span<const std::byte> bytes, size_t image, bool compression, int virtualSize) const;
+
+	const TextureCache * textureCache_ = nullptr;
+	bool compression_ = false;
+	int virtualSize_ = 0;
+	QThreadPool pool_;
+
+	mutable QMutex mutex_;
+	QWaitCondition finishedCondition_;
+	std::vector<Decoded> finished_;
+	size_t pending_ = 0;
+
+	// Only used by the GL thread.
+	TexturePacker packer_;
+};
+
+}// namespace fgl
@@ -0,0 +1,148 @@
+#include "InstrumentedFunctions.hpp"
+
+namespace fgl
+{
+
+namespace
+{
+
+size_t triangleCount(const GLenum mode, const GLsizei count)
+{
+	switch (mode)
+	{
+		case GL_TRIANGLES:
+			return static_cast<size_t>(count) / 3;
+		case GL_TRIANGLE_STRIP:
+		case GL_TRIANGLE_FAN:
+			return count > 2 ? static_cast<size_t>(count) - 2 : 0;
+		default:
+			return 0;
+	}
+}
+
+}// namespace
+
+void InstrumentedFunctions::glDrawArrays(const GLenum mode, const GLint first, const GLsizei count)
+{
+	countDraw(mode, count);
+	QOpenGLFunctions::glDrawArrays(mode, first, count);
+}
+
+void InstrumentedFunctions::glDrawElements(const GLenum mode, const GLsizei count, const GLenum type, const GLvoid * indices)
+{
+	countDraw(mode, count);
+	QOpenGLFunctions::glDrawElements(mode, count, type, indices);
+}
+
+void InstrumentedFunctions::glDrawArraysInstanced(const GLenum mode, const GLint first, const GLsizei count, const GLsizei instances)
+{
+	countDraw(mode, count, instances);
+	QOpenGLExtraFunctions::glDrawArraysInstanced(mode, first, count, instances);
+}
+
+void InstrumentedFunctions::glDrawElementsInstanced(const GLenum mode, const GLsizei count, const GLenum type, const void * indices,
+													const GLsizei instances)
+{
+	countDraw(mode, count, instances);
+	QOpenGLExtraFunctions::glDrawElementsInstanced(mode, count, type, indices, instances);
+}
+
+void InstrumentedFunctions::glDrawElementsBaseVertex(const GLenum mode, const GLsizei count, const GLenum type, const void * indices,
+													 const GLint baseVertex)
+{
+	countDraw(mode, count);
+	QOpenGLExtraFunctions::glDrawElementsBaseVertex(mode, count, type, indices, baseVertex);
+}
+
+void InstrumentedFunctions::glDrawElementsInstancedBaseVertex(const GLenum mode, const GLsizei count, const GLenum type,
+															  const void * indices, const GLsizei instances, const GLint baseVertex)
+{
+	countDraw(mode, count, instances);
+	QOpenGLExtraFunctions::glDrawElementsInstancedBaseVertex(mode, count, type, indices, instances, baseVertex);
+}
+
+void InstrumentedFunctions::glUseProgram(const GLuint program)
+{
+	++counters_.programBinds;
+	QOpenGLFunctions::glUseProgram(program);
+}
+
+void InstrumentedFunctions::glBindTexture(const GLenum target, const GLuint texture)
+{
+	++counters_.textureBinds;
+	QOpenGLFunctions::glBindTexture(target, texture);
+}
+
+void InstrumentedFunctions::glBufferData(const GLenum target, const GLsizeiptr size, const void * data, const GLenum usage)
+{
+	++counters_.bufferUploads;
+	counters_.uploadedBytes += data ? static_cast<size_t>(size) : 0;
+	QOpenGLFunctions::glBufferData(target, size, data, usage);
+}
+
+void InstrumentedFunctions::glBufferSubData(const GLenum target, const GLintptr offset, const GLsizeiptr size, const void * data)
+{
+	++counters_.bufferUploads;
+	counters_.uploadedBytes += static_cast<size_t>(size);
+	QOpenGLFunctions::glBufferSubData(target, offset, size, data);
+}
+
+void InstrumentedFunctions::bind(QOpenGLShaderProgram & program)
+{
+	++counters_.programBinds;
+	program.bind();
+}
+
+void InstrumentedFunctions::bind(QOpenGLVertexArrayObject & vao)
+{
+	++counters_.vertexArrayBinds;
+	vao.bind();
+}
+
+void InstrumentedFunctions::bind(QOpenGLTexture & texture)
+{
+	++counters_.textureBinds;
+	texture.bind();
+}
+
+void InstrumentedFunctions::allocate(QOpenGLBuffer & buffer, const void * data, const int size)
+{
+	++counters_.bufferUploads;
+	counters_.uploadedBytes += data ? static_cast<size_t>(size) : 0;
+	buffer.allocate(data, size);
+}
+
+void InstrumentedFunctions::multiDrawElementsIndirect(QOpenGLFunctions_4_3_Core & functions, const GLenum mode, const GLenum type,
+													   const size_t offset, const gsl::span<const DrawElementsIndirectCommand> commands)
+{
+	++counters_.drawCalls;
+	for (const auto & command: commands)
+	{
+		counters_.triangles += triangleCount(mode, static_cast<GLsizei>(command.count)) * command.instanceCount;
+	}
+	functions.glMultiDrawElementsIndirect(mode, type, reinterpret_cast<const void *>(offset), static_cast<GLsizei>(commands.size()), 0);
+}
+
+void InstrumentedFunctions::countUpload(const size_t bytes) noexcept
+{
+	++counters_.bufferUploads;
+	counters_.uploadedBytes += bytes;
+}
+
+const DrawCounters & InstrumentedFunctions::counters() const noexcept
+{
+	return counters_;
+}
+
+void InstrumentedFunctions::resetCounters() noexcept
+{
+	counters_ = {};
+}
+
+void InstrumentedFunctions::countDraw(const GLenum mode, const GLsizei count, const GLsizei instances)
+{
+	++counters_.drawCalls;
+	counters_.triangles += triangleCount(mode, count) * static_cast<size_t>(instances);
+}
+
+}// namespace fgl
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QOpenGLBuffer>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLFunctions_4_3_Core>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+
+#include <gsl/span>
+
+namespace fgl
+{
+
+// Layout of glMultiDrawElementsIndirect() commands.
+struct DrawElementsIndirectCommand {
+	GLuint count = 0;
+	GLuint instanceCount = 0;
+	GLuint firstIndex = 0;
+	GLint baseVertex = 0;
+	GLuint baseInstance = 0;
+};
+
+// Numbers of GL calls issued through InstrumentedFunctions.
+struct DrawCounters {
+	size_t drawCalls = 0;
+	// Instanced draws count triangles of all instances.
+	size_t triangles = 0;
+	size_t programBinds = 0;
+	size_t vertexArrayBinds = 0;
+	size_t textureBinds = 0;
+	size_t bufferUploads = 0;
+	size_t uploadedBytes = 0;
+};
+
+// QOpenGLExtraFunctions counting draws, binds and buffer uploads. Counting
+// functions hide the base ones of the same name. Qt helper classes call GL
+// through their own function tables, so they are bound with bind() and
+// allocate() below to be counted.
+class InstrumentedFunctions : public QOpenGLExtraFunctions
+{
+public:
+	void glDrawArrays(GLenum mode, GLint first, GLsizei count);
+	void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid * indices);
+	void glDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instances);
+	void glDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void * indices, GLsizei instances);
+	void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void * indices, GLint baseVertex);
+	void glDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void * indices, GLsizei instances, GLint baseVertex);
+	void glUseProgram(GLuint program);
+	void glBindTexture(GLenum target, GLuint texture);
+	void glBufferData(GLenum target, GLsizeiptr size, const void * data, GLenum usage);
+	void glBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const void * data);
+
+	void bind(QOpenGLShaderProgram & program);
+	void bind(QOpenGLVertexArrayObject & vao);
+	void bind(QOpenGLTexture & texture);
+	void allocate(QOpenGLBuffer & buffer, const void * data, int size);
+	// Draws commands written at offset of the bound indirect buffer through
+	// GL 4.3 functions, counted as a single draw call.
+	void multiDrawElementsIndirect(QOpenGLFunctions_4_3_Core & functions, GLenum mode, GLenum type, size_t offset,
+								   gsl::span<const DrawElementsIndirectCommand> commands);
+	// Counts data written into mapped buffers.
+	void countUpload(size_t bytes) noexcept;
+
+	[[nodiscard]] const DrawCounters & counters() const noexcept;
+	void resetCounters() noexcept;
+
+protected:
+	void countDraw(GLenum mode, GLsizei count, GLsizei instances = 1);
+
+protected:
+	DrawCounters counters_;
+};
+
+}// namespace fgl
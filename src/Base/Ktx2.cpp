@@ -0,0 +1,214 @@
+#include "Ktx2.hpp"
+
+#include <QtEndian>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr std::array<unsigned char, 12> g_identifier{0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr size_t g_headerSize = 80;
+constexpr size_t g_levelRecordSize = 24;
+constexpr auto g_writer = "fgl 1";
+
+// VkFormat values.
+constexpr quint32 g_bc1RgbUnorm = 131;
+constexpr quint32 g_bc3Unorm = 137;
+
+// Khronos data format descriptor values.
+constexpr quint32 g_modelBc1 = 128;
+constexpr quint32 g_modelBc3 = 130;
+constexpr quint32 g_primariesBt709 = 1;
+constexpr quint32 g_transferLinear = 1;
+constexpr quint32 g_channelColor = 0;
+constexpr quint32 g_channelAlpha = 15;
+
+quint32 vkFormat(const GLenum format)
+{
+	switch (format)
+	{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			return g_bc1RgbUnorm;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return g_bc3Unorm;
+		default:
+			return 0;
+	}
+}
+
+GLenum glFormat(const quint32 format)
+{
+	switch (format)
+	{
+		case g_bc1RgbUnorm:
+			return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+		case g_bc3Unorm:
+			return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+		default:
+			return 0;
+	}
+}
+
+void append32(QByteArray & file, const quint32 value)
+{
+	std::array<char, sizeof(quint32)> bytes{};
+	qToLittleEndian(value, bytes.data());
+	file.append(bytes.data(), static_cast<int>(bytes.size()));
+}
+
+void write64(QByteArray & file, const size_t offset, const quint64 value)
+{
+	qToLittleEndian(value, file.data() + offset);
+}
+
+void pad(QByteArray & file, const size_t alignment)
+{
+	const auto size = static_cast<size_t>(file.size());
+	file.append(static_cast<int>((alignment - size % alignment) % alignment), '\0');
+}
+
+quint32 read32(const gsl::span<const std::byte> file, const size_t offset)
+{
+	return qFromLittleEndian<quint32>(file.data() + offset);
+}
+
+quint64 read64(const gsl::span<const std::byte> file, const size_t offset)
+{
+	return qFromLittleEndian<quint64>(file.data() + offset);
+}
+
+// Basic descriptor block with one sample per 64-bit block half.
+void appendDescriptor(QByteArray & file, const GLenum format, const size_t blockSize)
+{
+	const auto alpha = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	const quint32 samples = alpha ? 2 : 1;
+	const auto blockBytes = 24 + 16 * samples;
+	append32(file, 4 + blockBytes);
+	// Khronos vendor and basic descriptor type.
+	append32(file, 0);
+	append32(file, 2 | (blockBytes << 16));
+	append32(file, (alpha ? g_modelBc3 : g_modelBc1) | (g_primariesBt709 << 8) | (g_transferLinear << 16));
+	// Block dimensions are stored minus one.
+	append32(file, 3 | (3 << 8));
+	append32(file, static_cast<quint32>(blockSize));
+	append32(file, 0);
+	for (quint32 i = 0; i < samples; ++i)
+	{
+		const auto channel = alpha && i == 0 ? g_channelAlpha : g_channelColor;
+		append32(file, (i * 64) | (63 << 16) | (channel << 24));
+		append32(file, 0);
+		append32(file, 0);
+		append32(file, 0xFFFFFFFF);
+	}
+}
+
+}// namespace
+
+QByteArray writeKtx2(const CompressedTexture & texture)
+{
+	const auto format = vkFormat(texture.format);
+	if (!format || texture.levels.empty())
+	{
+		return {};
+	}
+	const auto levelCount = texture.levels.size();
+	const auto & base = texture.levels.front();
+
+	QByteArray file(reinterpret_cast<const char *>(g_identifier.data()), static_cast<int>(g_identifier.size()));
+	append32(file, format);
+	// Type size, width, height, depth, layers, faces, levels and no supercompression.
+	append32(file, 1);
+	append32(file, static_cast<quint32>(base.width));
+	append32(file, static_cast<quint32>(base.height));
+	append32(file, 0);
+	append32(file, 0);
+	append32(file, 1);
+	append32(file, static_cast<quint32>(levelCount));
+	append32(file, 0);
+
+	// Index is filled once sections are placed.
+	const auto index = static_cast<size_t>(file.size());
+	file.append(static_cast<int>(g_headerSize - index + levelCount * g_levelRecordSize), '\0');
+
+	const auto blockSize = CompressedTexture::blockSize(texture.format);
+	const auto dfdOffset = static_cast<quint32>(file.size());
+	appendDescriptor(file, texture.format, blockSize);
+	const auto dfdSize = static_cast<quint32>(file.size()) - dfdOffset;
+
+	const auto kvdOffset = static_cast<quint32>(file.size());
+	const QByteArray key = QByteArray("KTXwriter") + '\0' + g_writer + '\0';
+	append32(file, static_cast<quint32>(key.size()));
+	file.append(key);
+	pad(file, 4);
+	const auto kvdSize = static_cast<quint32>(file.size()) - kvdOffset;
+
+	qToLittleEndian(dfdOffset, file.data() + index);
+	qToLittleEndian(dfdSize, file.data() + index + 4);
+	qToLittleEndian(kvdOffset, file.data() + index + 8);
+	qToLittleEndian(kvdSize, file.data() + index + 12);
+
+	// Levels go from the smallest, each aligned to its block size.
+	for (auto level = levelCount; level-- > 0;)
+	{
+		pad(file, blockSize);
+		const auto & data = texture.levels[level].data;
+		const auto record = g_headerSize + level * g_levelRecordSize;
+		write64(file, record, static_cast<quint64>(file.size()));
+		write64(file, record + 8, data.size());
+		write64(file, record + 16, data.size());
+		file.append(reinterpret_cast<const char *>(data.data()), static_cast<int>(data.size()));
+	}
+	return file;
+}
+
+bool readKtx2(const gsl::span<const std::byte> file, CompressedTexture & texture)
+{
+	if (file.size() < g_headerSize || std::memcmp(file.data(), g_identifier.data(), g_identifier.size()))
+	{
+		return false;
+	}
+	const auto format = glFormat(read32(file, 12));
+	const auto typeSize = read32(file, 16);
+	const auto width = read32(file, 20);
+	const auto height = read32(file, 24);
+	const auto depth = read32(file, 28);
+	const auto layers = read32(file, 32);
+	const auto faces = read32(file, 36);
+	const size_t levelCount = read32(file, 40);
+	const auto supercompression = read32(file, 44);
+	// Zero levels ask for generated mips, which compressed formats lack.
+	if (!format || typeSize != 1 || !width || !height || width > 1u << 16 || height > 1u << 16 || depth || layers
+		|| faces != 1 || !levelCount || levelCount > 32 || supercompression
+		|| file.size() < g_headerSize + levelCount * g_levelRecordSize)
+	{
+		return false;
+	}
+
+	CompressedTexture result;
+	result.format = format;
+	for (size_t i = 0; i < levelCount; ++i)
+	{
+		auto & level = result.levels.emplace_back();
+		level.width = std::max(static_cast<int>(width >> i), 1);
+		level.height = std::max(static_cast<int>(height >> i), 1);
+		const auto record = g_headerSize + i * g_levelRecordSize;
+		const auto offset = read64(file, record);
+		const auto size = read64(file, record + 8);
+		if (size != CompressedTexture::levelSize(format, level.width, level.height) || offset > file.size()
+			|| size > file.size() - offset)
+		{
+			return false;
+		}
+		level.data.assign(file.begin() + static_cast<std::ptrdiff_t>(offset), file.begin() + static_cast<std::ptrdiff_t>(offset + size));
+	}
+	texture = std::move(result);
+	return true;
+}
+
+}// namespace fgl
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "TextureCompressor.hpp"
+
+#include <QByteArray>
+
+#include <gsl/span>
+
+namespace fgl
+{
+
+// KTX2 container of a compressed 2D texture: header, level index, basic
+// data format descriptor and the writer key, followed by levels from the
+// smallest one. Only BC1 RGB and BC3 without supercompression are known.
+[[nodiscard]] QByteArray writeKtx2(const CompressedTexture & texture);
+// Returns false for other formats and malformed files.
+[[nodiscard]] bool readKtx2(gsl::span<const std::byte> file, CompressedTexture & texture);
+
+}// namespace fgl
@@ -0,0 +1,340 @@
+#include "MappedGltf.hpp"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QUrl>
+#include <QtEndian>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr quint32 g_glbMagic = 0x46546C67;// "glTF"
+constexpr quint32 g_jsonChunk = 0x4E4F534A;// "JSON"
+constexpr quint32 g_binChunk = 0x004E4942;// "BIN\0"
+
+// Smallest data URIs tinygltf accepts, they replace mapped data in JSON.
+constexpr auto g_placeholderBuffer = "data:application/octet-stream;base64,AA==";
+constexpr auto g_placeholderImage = "data:image/png;base64,AA==";
+
+struct Chunks {
+	MappedGltf::Bytes json;
+	MappedGltf::Bytes bin;
+};
+
+quint32 readUInt32(const MappedGltf::Bytes bytes, const size_t offset)
+{
+	return qFromLittleEndian<quint32>(bytes.data() + offset);
+}
+
+bool splitGlb(const MappedGltf::Bytes file, Chunks & chunks, QString & error)
+{
+	if (file.size() < 20 || readUInt32(file, 0) != g_glbMagic || readUInt32(file, 4) != 2)
+	{
+		error = "Invalid GLB header.";
+		return false;
+	}
+	const auto length = std::min<size_t>(readUInt32(file, 8), file.size());
+
+	size_t offset = 12;
+	while (offset + 8 <= length)
+	{
+		const size_t chunkLength = readUInt32(file, offset);
+		const auto chunkType = readUInt32(file, offset + 4);
+		offset += 8;
+		if (offset + chunkLength > length)
+		{
+			error = "GLB chunk exceeds file size.";
+			return false;
+		}
+		if (chunkType == g_jsonChunk && chunks.json.empty())
+		{
+			chunks.json = file.subspan(offset, chunkLength);
+		}
+		else if (chunkType == g_binChunk && chunks.bin.empty())
+		{
+			chunks.bin = file.subspan(offset, chunkLength);
+		}
+		// Chunks are aligned to 4 bytes.
+		offset += (chunkLength + 3) & ~size_t{3};
+	}
+
+	if (chunks.json.empty())
+	{
+		error = "GLB has no JSON chunk.";
+		return false;
+	}
+	return true;
+}
+
+struct ImageSources {
+	bool deferred = false;
+	std::vector<int> bufferViews;
+	// Images replaced by placeholders.
+	std::vector<bool> skipped;
+	// Encoded data URI images kept for deferred decoding.
+	std::vector<std::vector<unsigned char>> copies;
+};
+
+// Image bytes in mapped files are decoded after parsing, others right away
+// unless decoding is deferred.
+bool loadImageData(tinygltf::Image * image, const int index, std::string * err, std::string * warn,
+				   const int width, const int height, const unsigned char * bytes, const int size, void * userData)
+{
+	auto & sources = *static_cast<ImageSources *>(userData);
+	const auto i = static_cast<size_t>(index);
+	if (i < sources.skipped.size() && sources.skipped[i])
+	{
+		return true;
+	}
+	if (sources.deferred && i < sources.copies.size())
+	{
+		sources.copies[i].assign(bytes, bytes + size);
+		return true;
+	}
+	return tinygltf::LoadImageData(image, index, err, warn, width, height, bytes, size, nullptr);
+}
+
+}// namespace
+
+MappedGltf::MappedGltf()
+	: model_{std::make_unique<tinygltf::Model>()}
+{
+}
+
+MappedGltf::~MappedGltf() = default;
+
+bool MappedGltf::open(const QString & path, const ImageDecoding decoding)
+{
+	const auto file = map(path);
+	if (file.empty())
+	{
+		return false;
+	}
+	const auto baseDir = QFileInfo(path).absoluteDir();
+
+	Chunks chunks;
+	const auto binary = file.size() >= 4 && readUInt32(file, 0) == g_glbMagic;
+	if (binary && !splitGlb(file, chunks, error_))
+	{
+		return false;
+	}
+	chunks.json = binary ? chunks.json : file;
+
+	QJsonParseError parseError;
+	const auto json = QByteArray::fromRawData(reinterpret_cast<const char *>(chunks.json.data()), static_cast<int>(chunks.json.size()));
+	auto root = QJsonDocument::fromJson(json, &parseError).object();
+	if (parseError.error != QJsonParseError::NoError)
+	{
+		error_ = parseError.errorString();
+		return false;
+	}
+
+	// Replace binary and external buffers with placeholders, so tinygltf
+	// does not copy them, and map them instead.
+	auto buffers = root["buffers"].toArray();
+	buffers_.assign(static_cast<size_t>(buffers.size()), Bytes{});
+	for (int i = 0; i < buffers.size(); ++i)
+	{
+		auto buffer = buffers[i].toObject();
+		const auto uri = buffer["uri"].toString();
+		const auto byteLength = static_cast<size_t>(buffer["byteLength"].toDouble());
+		if (uri.startsWith("data:"))
+		{
+			continue;
+		}
+
+		auto & mapped = buffers_[static_cast<size_t>(i)];
+		mapped = uri.isEmpty() ? chunks.bin : map(baseDir.filePath(QUrl::fromPercentEncoding(uri.toUtf8())));
+		if (mapped.size() < byteLength)
+		{
+			error_ = error_.isEmpty() ? QString("Buffer %1 is truncated.").arg(i) : error_;
+			return false;
+		}
+		mapped = mapped.first(byteLength);
+
+		buffer["uri"] = g_placeholderBuffer;
+		buffer["byteLength"] = 1;
+		buffers.replace(i, buffer);
+	}
+	if (!buffers.isEmpty())
+	{
+		root["buffers"] = buffers;
+	}
+
+	// Images stored in buffer views would be read from placeholders.
+	// Deferred decoding maps external images too and only keeps bytes.
+	auto images = root["images"].toArray();
+	ImageSources sources;
+	sources.deferred = decoding == ImageDecoding::Deferred;
+	sources.bufferViews.assign(static_cast<size_t>(images.size()), -1);
+	sources.skipped.assign(sources.bufferViews.size(), false);
+	sources.copies.resize(sources.bufferViews.size());
+	images_.assign(sources.bufferViews.size(), Bytes{});
+	std::vector<QString> uris(sources.bufferViews.size());
+	std::vector<QString> mimeTypes(sources.bufferViews.size());
+	for (int i = 0; i < images.size(); ++i)
+	{
+		const auto index = static_cast<size_t>(i);
+		auto image = images[i].toObject();
+		const auto uri = image["uri"].toString();
+		if (image.contains("bufferView"))
+		{
+			sources.bufferViews[index] = image["bufferView"].toInt();
+			image.remove("bufferView");
+		}
+		else if (sources.deferred && !uri.isEmpty() && !uri.startsWith("data:"))
+		{
+			images_[index] = map(baseDir.filePath(QUrl::fromPercentEncoding(uri.toUtf8())));
+			if (images_[index].empty())
+			{
+				return false;
+			}
+		}
+		else
+		{
+			continue;
+		}
+		sources.skipped[index] = true;
+		uris[index] = uri;
+		mimeTypes[index] = image["mimeType"].toString();
+		image["uri"] = g_placeholderImage;
+		images.replace(i, image);
+	}
+	if (!images.isEmpty())
+	{
+		root["images"] = images;
+	}
+
+	const auto rewritten = QJsonDocument(root).toJson(QJsonDocument::Compact);
+
+	tinygltf::TinyGLTF loader;
+	loader.SetImageLoader(loadImageData, &sources);
+	std::string error;
+	std::string warning;
+	if (!loader.LoadASCIIFromString(model_.get(), &error, &warning, rewritten.constData(),
+									static_cast<unsigned int>(rewritten.size()), baseDir.absolutePath().toStdString()))
+	{
+		error_ = QString::fromStdString(error);
+		return false;
+	}
+
+	// Data URI buffers are owned by tinygltf.
+	for (size_t i = 0; i < buffers_.size(); ++i)
+	{
+		auto & data = model_->buffers[i].data;
+		if (buffers_[i].empty())
+		{
+			buffers_[i] = gsl::as_bytes(gsl::span<const unsigned char>{data});
+		}
+		else
+		{
+			data.clear();
+			data.shrink_to_fit();
+		}
+	}
+
+	// Restore images stored in buffer views and decode them unless deferred.
+	imageCopies_ = std::move(sources.copies);
+	for (size_t i = 0; i < images_.size(); ++i)
+	{
+		auto & image = model_->images[i];
+		if (sources.skipped[i])
+		{
+			image.uri = uris[i].toStdString();
+			image.bufferView = sources.bufferViews[i];
+			image.mimeType = mimeTypes[i].toStdString();
+		}
+		if (image.bufferView >= 0)
+		{
+			images_[i] = bufferView(static_cast<size_t>(image.bufferView));
+		}
+		else if (!imageCopies_[i].empty())
+		{
+			images_[i] = gsl::as_bytes(gsl::span<const unsigned char>{imageCopies_[i]});
+		}
+
+		if (sources.deferred || image.bufferView < 0)
+		{
+			continue;
+		}
+		const auto bytes = images_[i];
+		if (!tinygltf::LoadImageData(&image, static_cast<int>(i), &error, &warning, 0, 0,
+									 reinterpret_cast<const unsigned char *>(bytes.data()), static_cast<int>(bytes.size()), nullptr))
+		{
+			error_ = QString::fromStdString(error);
+			return false;
+		}
+		images_[i] = Bytes{};
+	}
+
+	return true;
+}
+
+const tinygltf::Model & MappedGltf::model() const noexcept
+{
+	return *model_;
+}
+
+tinygltf::Model & MappedGltf::model() noexcept
+{
+	return *model_;
+}
+
+auto MappedGltf::buffer(const size_t index) const -> Bytes
+{
+	return buffers_[index];
+}
+
+auto MappedGltf::encodedImage(const size_t index) const -> Bytes
+{
+	return images_[index];
+}
+
+auto MappedGltf::bufferView(const size_t index) const -> Bytes
+{
+	const auto & view = model_->bufferViews[index];
+	const auto data = buffer(static_cast<size_t>(view.buffer));
+	if (view.byteOffset + view.byteLength > data.size())
+	{
+		return {};
+	}
+	return data.subspan(view.byteOffset, view.byteLength);
+}
+
+const QString & MappedGltf::error() const noexcept
+{
+	return error_;
+}
+
+auto MappedGltf::map(const QString & path) -> Bytes
+{
+	auto file = std::make_unique<QFile>(path);
+	if (!file->open(QIODevice::ReadOnly))
+	{
+		error_ = file->errorString();
+		return {};
+	}
+
+	const auto size = file->size();
+	if (auto * data = file->map(0, size))
+	{
+		files_.push_back(std::move(file));
+		return {reinterpret_cast<const std::byte *>(data), static_cast<size_t>(size)};
+	}
+
+	// Compressed resources can not be mapped.
+	const auto & bytes = fallbacks_.emplace_back(file->readAll());
+	return {reinterpret_cast<const std::byte *>(bytes.constData()), static_cast<size_t>(bytes.size())};
+}
+
+}// namespace fgl
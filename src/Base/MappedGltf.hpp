@@ -0,0 +1,75 @@
+#pragma once
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tinygltf
+{
+class Model;
+}// namespace tinygltf
+
+namespace fgl
+{
+
+// glTF asset whose binary buffers stay in memory mapped files.
+// tinygltf only parses the JSON part, GLB binary chunk and external .bin
+// files are exposed as spans into the mappings instead of being copied
+// into tinygltf::Buffer::data.
+class MappedGltf final
+{
+public:
+	using Bytes = gsl::span<const std::byte>;
+
+	enum class ImageDecoding
+	{
+		Immediate,
+		// Images are left encoded, see encodedImage().
+		Deferred,
+	};
+
+public:
+	MappedGltf();
+	~MappedGltf();
+
+	MappedGltf(const MappedGltf &) = delete;
+	MappedGltf(MappedGltf &&) = delete;
+	MappedGltf & operator=(const MappedGltf &) = delete;
+	MappedGltf & operator=(MappedGltf &&) = delete;
+
+	// Opens .glb or .gltf file, Qt resource paths are supported.
+	[[nodiscard]] bool open(const QString & path, ImageDecoding decoding = ImageDecoding::Immediate);
+
+	[[nodiscard]] const tinygltf::Model & model() const noexcept;
+	[[nodiscard]] tinygltf::Model & model() noexcept;
+
+	[[nodiscard]] Bytes buffer(size_t index) const;
+	[[nodiscard]] Bytes bufferView(size_t index) const;
+	// Encoded bytes of not yet decoded image.
+	[[nodiscard]] Bytes encodedImage(size_t index) const;
+
+	[[nodiscard]] const QString & error() const noexcept;
+
+private:
+	// Maps a whole file, falls back to reading it for compressed resources.
+	[[nodiscard]] Bytes map(const QString & path);
+
+private:
+	std::unique_ptr<tinygltf::Model> model_;
+	std::vector<Bytes> buffers_;
+	std::vector<Bytes> images_;
+	std::vector<std::vector<unsigned char>> imageCopies_;
+
+	std::vector<std::unique_ptr<QFile>> files_;
+	std::vector<QByteArray> fallbacks_;
+
+	QString error_;
+};
+
+}// namespace fgl
@@ -0,0 +1,490 @@
+#include "MeshCache.hpp"
+
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr quint32 g_magic = 0x4D4C4746;// "FGLM"
+constexpr quint32 g_version = 6;
+constexpr size_t g_alignment = 16;
+constexpr auto g_extension = ".fglmesh";
+
+enum Section : size_t
+{
+	Views,
+	Images,
+	Materials,
+	Attributes,
+	Primitives,
+	Lods,
+	Meshes,
+	Nodes,
+	Data,
+	SectionCount,
+};
+
+struct Range {
+	quint64 offset = 0;
+	quint64 size = 0;
+};
+
+// Records are written as is, so padding is explicit and zeroed to keep
+// entries of the same scene byte identical.
+struct Header {
+	quint32 magic = g_magic;
+	quint32 version = g_version;
+	std::array<char, 20> source{};
+	quint32 padding = 0;
+	std::array<Range, SectionCount> sections{};
+};
+
+// Views and images are ranges in the data section.
+struct ViewRecord {
+	quint32 type = 0;
+	quint32 padding = 0;
+	Range data;
+};
+
+struct MaterialRecord {
+	std::array<float, 4> baseColor{};
+	qint32 baseColorTexture = -1;
+	quint32 filter = 0;
+	float anisotropy = 0.0f;
+	quint32 wrapS = 0;
+	quint32 wrapT = 0;
+};
+
+struct AttributeRecord {
+	quint32 location = 0;
+	quint32 view = 0;
+	qint32 size = 0;
+	quint32 type = 0;
+	quint32 normalized = 0;
+	qint32 stride = 0;
+	quint64 offset = 0;
+};
+
+struct PrimitiveRecord {
+	quint32 mode = 0;
+	qint32 count = 0;
+	quint32 indexType = 0;
+	qint32 indexView = -1;
+	quint64 indexOffset = 0;
+	qint32 material = -1;
+	quint32 firstAttribute = 0;
+	quint32 attributeCount = 0;
+	quint32 hasBounds = 0;
+	std::array<float, 3> min{};
+	std::array<float, 3> max{};
+	quint32 firstLod = 0;
+	quint32 lodCount = 0;
+	quint32 vertexCount = 0;
+	std::array<float, 4> dequantizeScale{};
+	std::array<float, 4> dequantizeOffset{};
+	quint32 padding = 0;
+};
+
+struct LodRecord {
+	qint32 count = 0;
+	float error = 0.0f;
+	quint64 indexOffset = 0;
+};
+
+struct MeshRecord {
+	quint32 firstPrimitive = 0;
+	quint32 primitiveCount = 0;
+};
+
+struct NodeRecord {
+	std::array<float, 16> world{};
+	quint64 mesh = 0;
+};
+
+static_assert(sizeof(Header) == 32 + sizeof(Range) * SectionCount);
+static_assert(sizeof(ViewRecord) == 8 + sizeof(Range));
+static_assert(sizeof(MaterialRecord) == 36);
+static_assert(sizeof(AttributeRecord) == 32);
+static_assert(sizeof(PrimitiveRecord) == 112);
+static_assert(sizeof(LodRecord) == 16);
+
+using Bytes = CookedScene::Bytes;
+
+size_t aligned(const size_t size)
+{
+	return (size + g_alignment - 1) & ~(g_alignment - 1);
+}
+
+void pad(QByteArray & blob)
+{
+	blob.append(static_cast<int>(aligned(static_cast<size_t>(blob.size())) - static_cast<size_t>(blob.size())), '\0');
+}
+
+template<class Record>
+Range append(QByteArray & blob, const std::vector<Record> & records)
+{
+	static_assert(std::is_trivially_copyable_v<Record>);
+	pad(blob);
+	const Range range{static_cast<quint64>(blob.size()), records.size() * sizeof(Record)};
+	blob.append(reinterpret_cast<const char *>(records.data()), static_cast<int>(range.size));
+	return range;
+}
+
+bool contains(const Range & outer, const Range & inner)
+{
+	return inner.offset <= outer.size && inner.size <= outer.size - inner.offset;
+}
+
+// Records are copied out, so the mapping does not have to be aligned.
+template<class Record>
+bool read(const Bytes file, const Range & range, std::vector<Record> & records)
+{
+	if (!contains({0, file.size()}, range) || range.size % sizeof(Record))
+	{
+		return false;
+	}
+	records.resize(range.size / sizeof(Record));
+	std::memcpy(records.data(), file.data() + range.offset, range.size);
+	return true;
+}
+
+Bytes subspan(const Bytes data, const Range & range)
+{
+	return contains({0, data.size()}, range) ? data.subspan(range.offset, range.size) : Bytes{};
+}
+
+}// namespace
+
+MeshCache::MeshCache(QString directory)
+	: directory_{std::move(directory)}
+{
+}
+
+QString MeshCache::defaultDirectory()
+{
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("meshes");
+}
+
+QByteArray MeshCache::hash(const QString & path)
+{
+	QFile file(path);
+	if (!file.open(QIODevice::ReadOnly))
+	{
+		return {};
+	}
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	if (const auto * data = file.map(0, file.size()))
+	{
+		hash.addData(reinterpret_cast<const char *>(data), static_cast<int>(file.size()));
+	}
+	else if (!hash.addData(&file))
+	{
+		return {};
+	}
+	return hash.result();
+}
+
+bool MeshCache::load(const QByteArray & key, CookedScene & scene)
+{
+	auto file = std::make_shared<QFile>(entryPath(key));
+	if (!file->exists())
+	{
+		return false;
+	}
+	const auto size = file->size();
+	const auto * mapped = file->open(QIODevice::ReadOnly) ? file->map(0, size) : nullptr;
+	if (!mapped || static_cast<size_t>(size) < sizeof(Header))
+	{
+		error_ = QString("Failed to map %1.").arg(file->fileName());
+		return false;
+	}
+	const Bytes blob{reinterpret_cast<const std::byte *>(mapped), static_cast<size_t>(size)};
+
+	Header header;
+	std::memcpy(&header, blob.data(), sizeof(Header));
+	if (header.magic != g_magic || header.version != g_version
+		|| QByteArray::fromRawData(header.source.data(), static_cast<int>(header.source.size())) != key)
+	{
+		error_ = QString("%1 is outdated.").arg(file->fileName());
+		return false;
+	}
+
+	std::vector<ViewRecord> views;
+	std::vector<Range> images;
+	std::vector<MaterialRecord> materials;
+	std::vector<AttributeRecord> attributes;
+	std::vector<PrimitiveRecord> primitives;
+	std::vector<LodRecord> lods;
+	std::vector<MeshRecord> meshes;
+	std::vector<NodeRecord> nodes;
+	const auto & sections = header.sections;
+	const auto data = subspan(blob, sections[Data]);
+	if (!read(blob, sections[Views], views) || !read(blob, sections[Images], images)
+		|| !read(blob, sections[Materials], materials) || !read(blob, sections[Attributes], attributes)
+		|| !read(blob, sections[Primitives], primitives) || !read(blob, sections[Lods], lods)
+		|| !read(blob, sections[Meshes], meshes)
+		|| !read(blob, sections[Nodes], nodes) || data.size() != sections[Data].size)
+	{
+		error_ = QString("%1 is corrupted.").arg(file->fileName());
+		return false;
+	}
+
+	// Only record indices and data ranges are validated here. Offsets into
+	// views are bounds checked by addGeometry() in GltfLoader.cpp and by
+	// CookedScene::positions().
+	const auto valid = [&] {
+		for (const auto & view: views)
+		{
+			if (!contains(sections[Data], view.data))
+			{
+				return false;
+			}
+		}
+		for (const auto & image: images)
+		{
+			if (!contains(sections[Data], image))
+			{
+				return false;
+			}
+		}
+		for (const auto & material: materials)
+		{
+			if (material.baseColorTexture >= static_cast<qint32>(images.size())
+				|| material.filter > static_cast<quint32>(SamplerPolicy::Filter::Trilinear))
+			{
+				return false;
+			}
+		}
+		for (const auto & attribute: attributes)
+		{
+			if (attribute.view >= views.size())
+			{
+				return false;
+			}
+		}
+		const auto validIndexType = [](const quint32 type) {
+			return !type || type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT || type == GL_UNSIGNED_INT;
+		};
+		for (const auto & primitive: primitives)
+		{
+			// Modes are GL_POINTS to GL_TRIANGLE_FAN, as in glTF.
+			if (primitive.mode > GL_TRIANGLE_FAN || !validIndexType(primitive.indexType)
+				|| (primitive.indexType && primitive.indexView < 0)
+				|| primitive.indexView >= static_cast<qint32>(views.size())
+				|| primitive.material >= static_cast<qint32>(materials.size())
+				|| primitive.firstAttribute > attributes.size()
+				|| primitive.attributeCount > attributes.size() - primitive.firstAttribute
+				|| primitive.firstLod > lods.size() || primitive.lodCount > lods.size() - primitive.firstLod)
+			{
+				return false;
+			}
+		}
+		for (const auto & mesh: meshes)
+		{
+			if (mesh.firstPrimitive > primitives.size() || mesh.primitiveCount > primitives.size() - mesh.firstPrimitive)
+			{
+				return false;
+			}
+		}
+		for (const auto & node: nodes)
+		{
+			if (node.mesh >= meshes.size())
+			{
+				return false;
+			}
+		}
+		return true;
+	}();
+	if (!valid)
+	{
+		error_ = QString("%1 is corrupted.").arg(file->fileName());
+		return false;
+	}
+
+	scene = {};
+	for (const auto & view: views)
+	{
+		scene.views.push_back({static_cast<QOpenGLBuffer::Type>(view.type), subspan(data, view.data)});
+	}
+	for (const auto & image: images)
+	{
+		scene.images.push_back(subspan(data, image));
+	}
+	for (const auto & material: materials)
+	{
+		const auto & color = material.baseColor;
+		const SamplerPolicy sampler{static_cast<SamplerPolicy::Filter>(material.filter), material.anisotropy, material.wrapS, material.wrapT};
+		scene.materials.push_back({QVector4D{color[0], color[1], color[2], color[3]}, material.baseColorTexture, sampler});
+	}
+	for (const auto & attribute: attributes)
+	{
+		scene.attributes.push_back({static_cast<Attribute>(attribute.location), attribute.view, attribute.size,
+									attribute.type, attribute.normalized != 0, attribute.stride, attribute.offset});
+	}
+	for (const auto & record: primitives)
+	{
+		auto & primitive = scene.primitives.emplace_back();
+		primitive.mode = record.mode;
+		primitive.count = record.count;
+		primitive.indexType = record.indexType;
+		primitive.indexView = record.indexView;
+		primitive.indexOffset = record.indexOffset;
+		primitive.material = record.material;
+		primitive.firstAttribute = record.firstAttribute;
+		primitive.attributeCount = record.attributeCount;
+		primitive.firstLod = record.firstLod;
+		primitive.lodCount = record.lodCount;
+		primitive.vertexCount = record.vertexCount;
+		primitive.dequantizeScale = record.dequantizeScale;
+		primitive.dequantizeOffset = record.dequantizeOffset;
+		if (record.hasBounds)
+		{
+			primitive.bounds.extend(QVector3D{record.min[0], record.min[1], record.min[2]});
+			primitive.bounds.extend(QVector3D{record.max[0], record.max[1], record.max[2]});
+		}
+	}
+	for (const auto & lod: lods)
+	{
+		scene.lods.push_back({lod.count, lod.indexOffset, lod.error});
+	}
+	for (const auto & mesh: meshes)
+	{
+		scene.meshes.push_back({mesh.firstPrimitive, mesh.primitiveCount});
+	}
+	for (const auto & record: nodes)
+	{
+		auto & node = scene.nodes.emplace_back();
+		std::memcpy(node.world.data(), record.world.data(), sizeof(record.world));
+		node.world.optimize();
+		node.mesh = record.mesh;
+	}
+
+	scene.owner = std::move(file);
+	return true;
+}
+
+bool MeshCache::store(const QByteArray & key, const CookedScene & scene)
+{
+	Header header;
+	if (static_cast<size_t>(key.size()) != header.source.size())
+	{
+		error_ = "Invalid cache key.";
+		return false;
+	}
+	std::memcpy(header.source.data(), key.constData(), header.source.size());
+
+	// Data section is laid out first to know the ranges.
+	QByteArray data;
+	const auto appendData = [&data](const Bytes bytes) {
+		pad(data);
+		const Range range{static_cast<quint64>(data.size()), bytes.size()};
+		data.append(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+		return range;
+	};
+
+	std::vector<ViewRecord> views;
+	for (const auto & view: scene.views)
+	{
+		views.push_back({static_cast<quint32>(view.type), 0, appendData(view.data)});
+	}
+	std::vector<Range> images;
+	for (const auto & image: scene.images)
+	{
+		images.push_back(appendData(image));
+	}
+	std::vector<MaterialRecord> materials;
+	for (const auto & material: scene.materials)
+	{
+		const auto & color = material.baseColor;
+		const auto & sampler = material.sampler;
+		materials.push_back({{color.x(), color.y(), color.z(), color.w()}, material.baseColorTexture,
+							 static_cast<quint32>(sampler.filter), sampler.anisotropy, sampler.wrapS, sampler.wrapT});
+	}
+	std::vector<AttributeRecord> attributes;
+	for (const auto & attribute: scene.attributes)
+	{
+		attributes.push_back({static_cast<quint32>(attribute.location), attribute.view, attribute.size,
+							  attribute.type, attribute.normalized ? 1u : 0u, attribute.stride, attribute.offset});
+	}
+	std::vector<PrimitiveRecord> primitives;
+	for (const auto & primitive: scene.primitives)
+	{
+		const auto & bounds = primitive.bounds;
+		primitives.push_back({primitive.mode, primitive.count, primitive.indexType, primitive.indexView,
+							  primitive.indexOffset, primitive.material, primitive.firstAttribute, primitive.attributeCount,
+							  bounds.valid ? 1u : 0u,
+							  {bounds.min.x(), bounds.min.y(), bounds.min.z()},
+							  {bounds.max.x(), bounds.max.y(), bounds.max.z()},
+							  primitive.firstLod, primitive.lodCount, primitive.vertexCount,
+							  primitive.dequantizeScale, primitive.dequantizeOffset, 0});
+	}
+	std::vector<LodRecord> lods;
+	for (const auto & lod: scene.lods)
+	{
+		lods.push_back({lod.count, lod.error, lod.indexOffset});
+	}
+	std::vector<MeshRecord> meshes;
+	for (const auto & mesh: scene.meshes)
+	{
+		meshes.push_back({mesh.firstPrimitive, mesh.primitiveCount});
+	}
+	std::vector<NodeRecord> nodes;
+	for (const auto & node: scene.nodes)
+	{
+		auto & record = nodes.emplace_back();
+		std::memcpy(record.world.data(), node.world.constData(), sizeof(record.world));
+		record.mesh = node.mesh;
+	}
+
+	QByteArray blob(static_cast<int>(sizeof(Header)), '\0');
+	auto & sections = header.sections;
+	sections[Views] = append(blob, views);
+	sections[Images] = append(blob, images);
+	sections[Materials] = append(blob, materials);
+	sections[Attributes] = append(blob, attributes);
+	sections[Primitives] = append(blob, primitives);
+	sections[Lods] = append(blob, lods);
+	sections[Meshes] = append(blob, meshes);
+	sections[Nodes] = append(blob, nodes);
+	pad(blob);
+	sections[Data] = {static_cast<quint64>(blob.size()), static_cast<quint64>(data.size())};
+	blob.append(data);
+	std::memcpy(blob.data(), &header, sizeof(Header));
+
+	// Written atomically, so readers never see a partial entry.
+	if (!QDir().mkpath(directory_))
+	{
+		error_ = QString("Failed to create %1.").arg(directory_);
+		return false;
+	}
+	QSaveFile file(entryPath(key));
+	if (!file.open(QIODevice::WriteOnly) || file.write(blob) != blob.size() || !file.commit())
+	{
+		error_ = file.errorString();
+		return false;
+	}
+	return true;
+}
+
+const QString & MeshCache::error() const noexcept
+{
+	return error_;
+}
+
+QString MeshCache::entryPath(const QByteArray & key) const
+{
+	return QDir(directory_).filePath(QString::fromLatin1(key.toHex()) + g_extension);
+}
+
+}// namespace fgl
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "CookedScene.hpp"
+
+#include <QByteArray>
+#include <QString>
+
+namespace fgl
+{
+
+// On-disk cache of cooked scenes. Each entry is a single blob named after
+// the SHA-1 of the source file: a header with the source hash and a section
+// table, fixed size records describing views, materials, primitives, their
+// levels of detail and nodes, followed by vertex, index and encoded image data. Entries are
+// memory mapped on load, so views are uploaded straight from the file.
+// Blobs use native byte order and are not meant to be shared between machines.
+class MeshCache final
+{
+public:
+	explicit MeshCache(QString directory = defaultDirectory());
+
+	[[nodiscard]] static QString defaultDirectory();
+	// Hash of the file content used as a cache key, empty on failure.
+	[[nodiscard]] static QByteArray hash(const QString & path);
+
+	// Returns false on cache miss or invalid entry.
+	[[nodiscard]] bool load(const QByteArray & key, CookedScene & scene);
+	[[nodiscard]] bool store(const QByteArray & key, const CookedScene & scene);
+
+	[[nodiscard]] const QString & error() const noexcept;
+
+private:
+	[[nodiscard]] QString entryPath(const QByteArray & key) const;
+
+private:
+	QString directory_;
+	QString error_;
+};
+
+}// namespace fgl
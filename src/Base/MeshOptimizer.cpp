@@ -0,0 +1,455 @@
+#include "MeshOptimizer.hpp"
+
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Primitives with fewer triangles are always drawn in full.
+constexpr size_t g_minLodTriangles = 256;
+constexpr size_t g_vertexAlignment = 16;
+constexpr auto g_locations = static_cast<size_t>(Attribute::Color) + 1;
+
+constexpr auto g_unused = std::numeric_limits<uint32_t>::max();
+
+size_t alignedTo(const size_t size, const size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+template<class Index>
+void appendIndices(std::vector<std::byte> & data, const std::vector<uint32_t> & indices)
+{
+	data.resize(alignedTo(data.size(), sizeof(uint32_t)));
+	for (const auto index: indices)
+	{
+		const auto value = static_cast<Index>(index);
+		const auto offset = data.size();
+		data.resize(offset + sizeof(value));
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+}
+
+}// namespace
+
+void VertexCacheStats::add(const VertexCacheStats & other)
+{
+	triangles += other.triangles;
+	vertices += other.vertices;
+	transformed += other.transformed;
+}
+
+float VertexCacheStats::acmr() const
+{
+	return triangles ? static_cast<float>(transformed) / static_cast<float>(triangles) : 0.0f;
+}
+
+float VertexCacheStats::atvr() const
+{
+	return vertices ? static_cast<float>(transformed) / static_cast<float>(vertices) : 0.0f;
+}
+
+VertexCacheStats analyzeVertexCache(const gsl::span<const uint32_t> indices, const size_t vertexCount, const size_t cacheSize)
+{
+	VertexCacheStats stats;
+	stats.triangles = indices.size() / 3;
+
+	// Vertex is cached while less than cacheSize others were loaded after it.
+	std::vector<size_t> loadedAt(vertexCount, std::numeric_limits<size_t>::max());
+	for (const auto index: indices)
+	{
+		auto & loaded = loadedAt[index];
+		if (loaded == std::numeric_limits<size_t>::max())
+		{
+			++stats.vertices;
+		}
+		else if (stats.transformed - loaded < cacheSize)
+		{
+			continue;
+		}
+		loaded = stats.transformed++;
+	}
+	return stats;
+}
+
+std::vector<uint32_t> optimizeTriangleOrder(const gsl::span<const uint32_t> indices, const gsl::span<const QVector3D> positions,
+											const size_t cacheSize)
+{
+	const auto triangleCount = indices.size() / 3;
+	const auto vertexCount = positions.size();
+
+	// Triangles around every vertex.
+	std::vector<uint32_t> live(vertexCount, 0);
+	for (size_t i = 0; i < triangleCount * 3; ++i)
+	{
+		++live[indices[i]];
+	}
+	std::vector<uint32_t> firstTriangle(vertexCount + 1, 0);
+	std::partial_sum(live.begin(), live.end(), firstTriangle.begin() + 1);
+	std::vector<uint32_t> adjacency(triangleCount * 3);
+	{
+		auto next = firstTriangle;
+		for (size_t i = 0; i < triangleCount * 3; ++i)
+		{
+			adjacency[next[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	}
+
+	// Tipsify: fans around the vertex which stays longest in the cache and
+	// still has triangles, dead ends restart from recently used vertices.
+	std::vector<size_t> cachedAt(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<uint32_t> deadEnds;
+	std::vector<uint32_t> candidates;
+	std::vector<uint32_t> order;
+	std::vector<size_t> clusters;
+	order.reserve(triangleCount);
+	auto time = cacheSize + 1;
+	size_t cursor = 0;
+
+	const auto nextDeadEnd = [&]() -> int64_t {
+		while (!deadEnds.empty())
+		{
+			const auto vertex = deadEnds.back();
+			deadEnds.pop_back();
+			if (live[vertex])
+			{
+				return vertex;
+			}
+		}
+		for (; cursor < vertexCount; ++cursor)
+		{
+			if (live[cursor])
+			{
+				return static_cast<int64_t>(cursor);
+			}
+		}
+		return -1;
+	};
+
+	int64_t fan = triangleCount ? indices[0] : -1;
+	clusters.push_back(0);
+	while (fan >= 0)
+	{
+		candidates.clear();
+		for (auto i = firstTriangle[static_cast<size_t>(fan)]; i < firstTriangle[static_cast<size_t>(fan) + 1]; ++i)
+		{
+			const auto triangle = adjacency[i];
+			if (emitted[triangle])
+			{
+				continue;
+			}
+			emitted[triangle] = true;
+			order.push_back(triangle);
+			for (size_t corner = 0; corner < 3; ++corner)
+			{
+				const auto vertex = indices[triangle * 3 + corner];
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				--live[vertex];
+				if (time - cachedAt[vertex] > cacheSize)
+				{
+					cachedAt[vertex] = time++;
+				}
+			}
+		}
+
+		// Candidate whose fan still fits into the cache and entered it first,
+		// none of them fitting ends the cluster.
+		fan = -1;
+		size_t best = 0;
+		for (const auto vertex: candidates)
+		{
+			if (!live[vertex])
+			{
+				continue;
+			}
+			const auto age = time - cachedAt[vertex];
+			const auto priority = age + 2 * live[vertex] <= cacheSize ? age : 0;
+			if (priority > best)
+			{
+				fan = vertex;
+				best = priority;
+			}
+		}
+		if (fan < 0)
+		{
+			fan = nextDeadEnd();
+			if (fan >= 0 && order.size() > clusters.back())
+			{
+				clusters.push_back(order.size());
+			}
+		}
+	}
+	clusters.push_back(order.size());
+
+	// Clusters facing away from the mesh center are likely to occlude the others.
+	const auto point = [&](const uint32_t triangle, const size_t corner) { return positions[indices[triangle * 3 + corner]]; };
+	QVector3D meshCenter;
+	float meshArea = 0.0f;
+	struct Cluster {
+		size_t begin = 0;
+		size_t end = 0;
+		QVector3D center;
+		QVector3D normal;
+		float area = 0.0f;
+		float sortKey = 0.0f;
+	};
+	std::vector<Cluster> sorted;
+	for (size_t i = 0; i + 1 < clusters.size(); ++i)
+	{
+		auto & cluster = sorted.emplace_back();
+		cluster.begin = clusters[i];
+		cluster.end = clusters[i + 1];
+		for (auto j = cluster.begin; j < cluster.end; ++j)
+		{
+			const auto normal = QVector3D::crossProduct(point(order[j], 1) - point(order[j], 0), point(order[j], 2) - point(order[j], 0));
+			const auto area = normal.length();
+			cluster.center += (point(order[j], 0) + point(order[j], 1) + point(order[j], 2)) * (area / 3.0f);
+			cluster.normal += normal;
+			cluster.area += area;
+		}
+		meshCenter += cluster.center;
+		meshArea += cluster.area;
+		cluster.center = cluster.area > 0.0f ? cluster.center / cluster.area : cluster.center;
+	}
+	meshCenter = meshArea > 0.0f ? meshCenter / meshArea : meshCenter;
+	for (auto & cluster: sorted)
+	{
+		const auto length = cluster.normal.length();
+		cluster.sortKey = length > 0.0f ? QVector3D::dotProduct(cluster.center - meshCenter, cluster.normal / length) : 0.0f;
+	}
+	std::stable_sort(sorted.begin(), sorted.end(), [](const auto & lhs, const auto & rhs) { return lhs.sortKey > rhs.sortKey; });
+
+	std::vector<uint32_t> result;
+	result.reserve(triangleCount * 3);
+	for (const auto & cluster: sorted)
+	{
+		for (auto j = cluster.begin; j < cluster.end; ++j)
+		{
+			result.insert(result.end(), indices.begin() + order[j] * 3, indices.begin() + order[j] * 3 + 3);
+		}
+	}
+	return result;
+}
+
+std::vector<uint32_t> optimizeVertexFetch(const gsl::span<const uint32_t> indices, const size_t vertexCount)
+{
+	std::vector<uint32_t> remap(vertexCount, g_unused);
+	uint32_t next = 0;
+	for (const auto index: indices)
+	{
+		if (remap[index] == g_unused)
+		{
+			remap[index] = next++;
+		}
+	}
+	return remap;
+}
+
+MeshOptimization optimizeMeshes(CookedScene & cooked, const VertexEncoding positionEncoding, const size_t lodLevels)
+{
+	MeshOptimization result;
+	std::vector<std::byte> vertexData;
+	std::vector<std::byte> indexData;
+	std::vector<CookedScene::VertexAttribute> attributes;
+
+	const auto vertexView = static_cast<uint32_t>(cooked.views.size());
+	const auto indexView = static_cast<int32_t>(vertexView + 1);
+	for (auto & primitive: cooked.primitives)
+	{
+		const auto sources = gsl::span<const CookedScene::VertexAttribute>{cooked.attributes}.subspan(primitive.firstAttribute, primitive.attributeCount);
+		primitive.firstAttribute = static_cast<uint32_t>(attributes.size());
+		primitive.attributeCount = 0;
+		primitive.lodCount = 0;
+
+		auto indices = primitive.mode == GL_TRIANGLES ? cooked.triangleIndices(primitive) : cooked.indices(primitive);
+		const auto vertexCount = indices.empty() ? 0 : static_cast<size_t>(*std::max_element(indices.begin(), indices.end())) + 1;
+		const auto readable = std::all_of(sources.begin(), sources.end(), [&](const auto & attribute) {
+			const auto size = componentSize(attribute.type) * static_cast<size_t>(attribute.size);
+			const auto stride = attribute.stride ? static_cast<size_t>(attribute.stride) : size;
+			return attribute.size <= 4 && attribute.offset + (vertexCount - 1) * stride + size <= cooked.views[attribute.view].data.size();
+		});
+		const auto hasPosition = std::any_of(sources.begin(), sources.end(), [](const auto & attribute) { return attribute.location == Attribute::Position; });
+		if (indices.empty() || !readable || !hasPosition)
+		{
+			// Such primitives would fetch outside of their buffers.
+			primitive.count = 0;
+			continue;
+		}
+
+		// Attributes are decoded to floats, missing components as in GL.
+		std::array<std::vector<std::array<float, 4>>, g_locations> values;
+		for (const auto & attribute: sources)
+		{
+			const auto size = componentSize(attribute.type) * static_cast<size_t>(attribute.size);
+			const auto stride = attribute.stride ? static_cast<size_t>(attribute.stride) : size;
+			const auto * source = cooked.views[attribute.view].data.data() + attribute.offset;
+			auto & decoded = values[static_cast<size_t>(attribute.location)];
+			decoded.assign(vertexCount, {0.0f, 0.0f, 0.0f, 1.0f});
+			for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+			{
+				readComponents(attribute.type, attribute.normalized, attribute.size, source + vertex * stride, decoded[vertex].data());
+			}
+		}
+		const auto & sourcePositions = values[static_cast<size_t>(Attribute::Position)];
+		std::vector<QVector3D> positions;
+		positions.reserve(vertexCount);
+		Bounds bounds;
+		for (const auto & position: sourcePositions)
+		{
+			bounds.extend(positions.emplace_back(position[0], position[1], position[2]));
+		}
+
+		// Levels are simplified before reordering, as they all share vertices.
+		std::vector<std::vector<uint32_t>> levels;
+		std::vector<float> errors;
+		if (primitive.mode == GL_TRIANGLES)
+		{
+			if (indices.size() / 3 >= g_minLodTriangles)
+			{
+				for (auto & level: simplify(positions, indices, lodLevels))
+				{
+					levels.push_back(std::move(level.indices));
+					errors.push_back(level.error);
+				}
+			}
+			result.before.add(analyzeVertexCache(indices, vertexCount));
+			indices = optimizeTriangleOrder(indices, positions);
+			for (auto & level: levels)
+			{
+				level = optimizeTriangleOrder(level, positions);
+			}
+		}
+
+		// Levels only use vertices of the full list, so one order fits all.
+		const auto remap = optimizeVertexFetch(indices, vertexCount);
+		const auto usedVertices = vertexCount - static_cast<size_t>(std::count(remap.begin(), remap.end(), g_unused));
+		for (auto & index: indices)
+		{
+			index = remap[index];
+		}
+		for (auto & level: levels)
+		{
+			for (auto & index: level)
+			{
+				index = remap[index];
+			}
+		}
+		if (primitive.mode == GL_TRIANGLES)
+		{
+			result.after.add(analyzeVertexCache(indices, usedVertices));
+		}
+
+		// Positions are stored relative to the bounds center, normalized by
+		// half extents for snorm16.
+		const auto center = bounds.center();
+		auto scale = (bounds.max - bounds.min) * 0.5f;
+		for (int axis = 0; axis < 3; ++axis)
+		{
+			scale[axis] = positionEncoding != VertexEncoding::Snorm16 || scale[axis] <= 0.0f ? 1.0f : scale[axis];
+		}
+		const auto offset = positionEncoding == VertexEncoding::Float ? QVector3D{} : center;
+
+		VertexFormat format;
+		format.add(Attribute::Position, positionEncoding, 3);
+		const auto hasNormals = !values[static_cast<size_t>(Attribute::Normal)].empty();
+		const auto hasColors = !values[static_cast<size_t>(Attribute::Color)].empty();
+		if (hasNormals)
+		{
+			format.add(Attribute::Normal, VertexEncoding::Octahedral, 3);
+		}
+		if (!values[static_cast<size_t>(Attribute::TexCoord)].empty())
+		{
+			format.add(Attribute::TexCoord, VertexEncoding::Half, 2);
+		}
+		if (hasColors)
+		{
+			format.add(Attribute::Color, VertexEncoding::Unorm8, 4);
+		}
+
+		const auto stride = static_cast<size_t>(format.stride());
+		vertexData.resize(alignedTo(vertexData.size(), g_vertexAlignment));
+		const auto base = vertexData.size();
+		vertexData.resize(base + usedVertices * stride);
+		for (size_t vertex = 0; vertex < vertexCount; ++vertex)
+		{
+			if (remap[vertex] == g_unused)
+			{
+				continue;
+			}
+			auto * target = vertexData.data() + base + remap[vertex] * stride;
+			for (const auto & element: format.elements())
+			{
+				auto value = values[static_cast<size_t>(element.location)][vertex];
+				if (element.location == Attribute::Position)
+				{
+					for (int axis = 0; axis < 3; ++axis)
+					{
+						value[static_cast<size_t>(axis)] = (value[static_cast<size_t>(axis)] - offset[axis]) / scale[axis];
+					}
+				}
+				VertexFormat::encode(element, value.data(), target);
+			}
+		}
+		for (const auto & element: format.elements())
+		{
+			attributes.push_back({element.location, vertexView, element.storedComponents(), element.type(), element.normalized(),
+								  format.stride(), base + element.offset});
+		}
+
+		primitive.vertexCount = static_cast<uint32_t>(usedVertices);
+		primitive.dequantizeScale = {scale[0], scale[1], scale[2], hasNormals ? 1.0f : 0.0f};
+		primitive.dequantizeOffset = {offset[0], offset[1], offset[2], hasColors ? 0.0f : 1.0f};
+		primitive.attributeCount = static_cast<uint32_t>(attributes.size()) - primitive.firstAttribute;
+
+		// Full list and levels share the index view and type.
+		const auto narrow = usedVertices <= std::numeric_limits<uint16_t>::max() + size_t{1};
+		const auto append = [&](const std::vector<uint32_t> & list) {
+			if (narrow)
+			{
+				appendIndices<uint16_t>(indexData, list);
+			}
+			else
+			{
+				appendIndices<uint32_t>(indexData, list);
+			}
+		};
+		primitive.indexType = narrow ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+		primitive.indexView = indexView;
+		primitive.indexOffset = alignedTo(indexData.size(), sizeof(uint32_t));
+		primitive.count = static_cast<GLsizei>(indices.size());
+		append(indices);
+
+		primitive.firstLod = static_cast<uint32_t>(cooked.lods.size());
+		primitive.lodCount = static_cast<uint32_t>(levels.size());
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			const auto offset = alignedTo(indexData.size(), sizeof(uint32_t));
+			cooked.lods.push_back({static_cast<GLsizei>(levels[i].size()), offset, errors[i]});
+			append(levels[i]);
+		}
+	}
+	cooked.attributes = std::move(attributes);
+
+	cooked.addView(QOpenGLBuffer::VertexBuffer, std::move(vertexData));
+	cooked.addView(QOpenGLBuffer::IndexBuffer, std::move(indexData));
+
+	// Source vertex and index views are neither uploaded nor cached anymore.
+	for (uint32_t i = 0; i < vertexView; ++i)
+	{
+		cooked.views[i].data = {};
+	}
+	return result;
+}
+
+}// namespace fgl
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "CookedScene.hpp"
+#include "VertexFormat.hpp"
+
+#include <QVector3D>
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <vector>
+
+namespace fgl
+{
+
+// Post-transform vertex cache behaviour of index lists.
+struct VertexCacheStats {
+	size_t triangles = 0;
+	// Distinct vertices referenced.
+	size_t vertices = 0;
+	// Cache misses, every one is a vertex shader invocation.
+	size_t transformed = 0;
+
+	void add(const VertexCacheStats & other);
+
+	// Average cache miss ratio, transformed vertices per triangle.
+	[[nodiscard]] float acmr() const;
+	// Average transformed to vertex ratio, one is optimal.
+	[[nodiscard]] float atvr() const;
+};
+
+constexpr size_t g_vertexCacheSize = 16;
+
+// Simulates a FIFO cache like the one of most GPUs.
+[[nodiscard]] VertexCacheStats analyzeVertexCache(gsl::span<const uint32_t> indices, size_t vertexCount,
+												  size_t cacheSize = g_vertexCacheSize);
+
+// Reorders triangles with Tipsify for vertex cache locality. Tipsify emits
+// clusters of triangles between cache flushes, clusters are then sorted so
+// the outward facing ones are drawn first, which cuts overdraw of convex
+// parts without hurting the cache.
+[[nodiscard]] std::vector<uint32_t> optimizeTriangleOrder(gsl::span<const uint32_t> indices, gsl::span<const QVector3D> positions,
+														  size_t cacheSize = g_vertexCacheSize);
+
+// Vertex order of the first use by indices for fetch locality. Returns new
+// index of every vertex, unused ones get ~0u.
+[[nodiscard]] std::vector<uint32_t> optimizeVertexFetch(gsl::span<const uint32_t> indices, size_t vertexCount);
+
+struct MeshOptimization {
+	VertexCacheStats before;
+	VertexCacheStats after;
+};
+
+// Cooking stage run over all primitives. Detailed triangle lists get
+// simplified levels of detail, then triangles of every level are reordered.
+// Vertices are repacked interleaved in fetch order with positions in
+// positionEncoding, octahedral normals, half texture coordinates and unorm8
+// colors, see Primitive::dequantizeScale for decoding. Indices are narrowed
+// to 16 bits where possible. Vertex and index data go to two generated
+// views, source views are cleared and primitives that could not be read
+// are emptied. Cache statistics are of full triangle lists.
+MeshOptimization optimizeMeshes(CookedScene & cooked, VertexEncoding positionEncoding = VertexEncoding::Snorm16, size_t lodLevels = 3);
+
+}// namespace fgl
@@ -0,0 +1,366 @@
+#include "MeshSimplifier.hpp"
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <functional>
+#include <numeric>
+#include <queue>
+#include <unordered_map>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Borders weigh more than faces, so open meshes keep their outline.
+constexpr double g_borderWeight = 10.0;
+// Levels keeping more of the previous triangles are not worth drawing.
+constexpr double g_minReduction = 0.8;
+
+using Quadric = glm::dmat4;
+
+Quadric planeQuadric(const glm::dvec3 & normal, const glm::dvec3 & point, const double weight)
+{
+	const glm::dvec4 plane{normal, -glm::dot(normal, point)};
+	return glm::outerProduct(plane, plane) * weight;
+}
+
+struct Collapse {
+	double cost = 0.0;
+	uint32_t from = 0;
+	uint32_t to = 0;
+
+	bool operator>(const Collapse & other) const
+	{
+		return cost > other.cost;
+	}
+};
+
+// Half edge collapses ordered by quadric error, costs are updated lazily
+// when collapses are popped from the queue.
+class Simplifier final
+{
+public:
+	Simplifier(gsl::span<const QVector3D> positions, gsl::span<const uint32_t> indices);
+
+	// Collapses edges until at most target triangles are left.
+	void reduce(size_t target);
+
+	[[nodiscard]] std::vector<uint32_t> indices() const;
+	[[nodiscard]] size_t triangles() const noexcept;
+	[[nodiscard]] float error() const noexcept;
+
+private:
+	[[nodiscard]] bool containsClass(uint32_t triangle, uint32_t vertexClass) const;
+	[[nodiscard]] bool connected(uint32_t from, uint32_t to) const;
+	[[nodiscard]] bool flips(uint32_t from, uint32_t to) const;
+	[[nodiscard]] double cost(uint32_t from, uint32_t to) const;
+	[[nodiscard]] glm::dvec3 normal(uint32_t triangle, uint32_t from, uint32_t to) const;
+	void push(uint32_t from, uint32_t to);
+	void collapse(uint32_t from, uint32_t to);
+
+private:
+	std::vector<glm::dvec3> positions_;
+	// Vertices sharing a position are of the same class, named by its first
+	// vertex. Classes of several vertices lie on attribute seams.
+	std::vector<uint32_t> classes_;
+	std::vector<bool> locked_;
+	// Indexed by class.
+	std::vector<Quadric> quadrics_;
+
+	std::vector<uint32_t> corners_;
+	std::vector<bool> alive_;
+	std::vector<std::vector<uint32_t>> vertexTriangles_;
+	size_t triangles_ = 0;
+
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<>> queue_;
+	double maxCost_ = 0.0;
+};
+
+Simplifier::Simplifier(const gsl::span<const QVector3D> positions, const gsl::span<const uint32_t> indices)
+	: positions_(positions.size())
+	, classes_(positions.size())
+	, locked_(positions.size(), false)
+	, quadrics_(positions.size(), Quadric{0.0})
+	, corners_(indices.begin(), indices.end())
+	, alive_(indices.size() / 3, true)
+	, vertexTriangles_(positions.size())
+{
+	for (size_t i = 0; i < positions.size(); ++i)
+	{
+		positions_[i] = {positions[i].x(), positions[i].y(), positions[i].z()};
+	}
+
+	// Equal positions end up next to each other.
+	std::vector<uint32_t> order(positions.size());
+	std::iota(order.begin(), order.end(), 0u);
+	const auto less = [&](const uint32_t lhs, const uint32_t rhs) {
+		const auto & a = positions_[lhs];
+		const auto & b = positions_[rhs];
+		return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z);
+	};
+	std::sort(order.begin(), order.end(), [&](const uint32_t lhs, const uint32_t rhs) {
+		return less(lhs, rhs) || (!less(rhs, lhs) && lhs < rhs);
+	});
+	for (size_t i = 0; i < order.size(); ++i)
+	{
+		const auto shared = i > 0 && positions_[order[i]] == positions_[order[i - 1]];
+		classes_[order[i]] = shared ? classes_[order[i - 1]] : order[i];
+		if (shared)
+		{
+			locked_[order[i]] = true;
+			locked_[order[i - 1]] = true;
+		}
+	}
+
+	// Face planes, edges used by a single face are counted to find borders.
+	std::unordered_map<uint64_t, uint32_t> edgeFaces;
+	const auto edgeKey = [&](const uint32_t a, const uint32_t b) {
+		const auto lhs = classes_[a];
+		const auto rhs = classes_[b];
+		return (static_cast<uint64_t>(std::min(lhs, rhs)) << 32) | std::max(lhs, rhs);
+	};
+	for (uint32_t t = 0; t < alive_.size(); ++t)
+	{
+		const auto * corner = &corners_[t * 3];
+		if (classes_[corner[0]] == classes_[corner[1]] || classes_[corner[1]] == classes_[corner[2]]
+			|| classes_[corner[2]] == classes_[corner[0]])
+		{
+			alive_[t] = false;
+			continue;
+		}
+		++triangles_;
+		for (int i = 0; i < 3; ++i)
+		{
+			vertexTriangles_[corner[i]].push_back(t);
+			++edgeFaces[edgeKey(corner[i], corner[(i + 1) % 3])];
+		}
+
+		const auto faceNormal = glm::cross(positions_[corner[1]] - positions_[corner[0]], positions_[corner[2]] - positions_[corner[0]]);
+		const auto length = glm::length(faceNormal);
+		if (length == 0.0)
+		{
+			continue;
+		}
+		const auto face = planeQuadric(faceNormal / length, positions_[corner[0]], 1.0);
+		for (int i = 0; i < 3; ++i)
+		{
+			quadrics_[classes_[corner[i]]] += face;
+		}
+	}
+
+	// Border planes are perpendicular to their faces.
+	for (uint32_t t = 0; t < alive_.size(); ++t)
+	{
+		const auto * corner = &corners_[t * 3];
+		if (!alive_[t])
+		{
+			continue;
+		}
+		const auto faceNormal = glm::cross(positions_[corner[1]] - positions_[corner[0]], positions_[corner[2]] - positions_[corner[0]]);
+		for (int i = 0; i < 3; ++i)
+		{
+			const auto a = corner[i];
+			const auto b = corner[(i + 1) % 3];
+			if (edgeFaces[edgeKey(a, b)] != 1)
+			{
+				continue;
+			}
+			const auto borderNormal = glm::cross(positions_[b] - positions_[a], faceNormal);
+			const auto length = glm::length(borderNormal);
+			if (length > 0.0)
+			{
+				const auto border = planeQuadric(borderNormal / length, positions_[a], g_borderWeight);
+				quadrics_[classes_[a]] += border;
+				quadrics_[classes_[b]] += border;
+			}
+		}
+	}
+
+	for (uint32_t t = 0; t < alive_.size(); ++t)
+	{
+		if (alive_[t])
+		{
+			for (int i = 0; i < 3; ++i)
+			{
+				push(corners_[t * 3 + i], corners_[t * 3 + (i + 1) % 3]);
+				push(corners_[t * 3 + (i + 1) % 3], corners_[t * 3 + i]);
+			}
+		}
+	}
+}
+
+void Simplifier::reduce(const size_t target)
+{
+	while (triangles_ > target && !queue_.empty())
+	{
+		const auto candidate = queue_.top();
+		queue_.pop();
+		if (!connected(candidate.from, candidate.to))
+		{
+			continue;
+		}
+		// Quadrics grew since the collapse was queued.
+		const auto current = cost(candidate.from, candidate.to);
+		if (current > candidate.cost * (1.0 + 1e-9) + 1e-18)
+		{
+			queue_.push({current, candidate.from, candidate.to});
+			continue;
+		}
+		if (flips(candidate.from, candidate.to))
+		{
+			continue;
+		}
+		maxCost_ = std::max(maxCost_, current);
+		collapse(candidate.from, candidate.to);
+	}
+}
+
+std::vector<uint32_t> Simplifier::indices() const
+{
+	std::vector<uint32_t> result;
+	result.reserve(triangles_ * 3);
+	for (size_t t = 0; t < alive_.size(); ++t)
+	{
+		if (alive_[t])
+		{
+			result.insert(result.end(), corners_.begin() + static_cast<std::ptrdiff_t>(t * 3),
+						  corners_.begin() + static_cast<std::ptrdiff_t>(t * 3 + 3));
+		}
+	}
+	return result;
+}
+
+size_t Simplifier::triangles() const noexcept
+{
+	return triangles_;
+}
+
+float Simplifier::error() const noexcept
+{
+	return static_cast<float>(std::sqrt(maxCost_));
+}
+
+bool Simplifier::containsClass(const uint32_t triangle, const uint32_t vertexClass) const
+{
+	const auto * corner = &corners_[triangle * 3];
+	return classes_[corner[0]] == vertexClass || classes_[corner[1]] == vertexClass || classes_[corner[2]] == vertexClass;
+}
+
+bool Simplifier::connected(const uint32_t from, const uint32_t to) const
+{
+	return std::any_of(vertexTriangles_[from].begin(), vertexTriangles_[from].end(), [&](const uint32_t t) {
+		const auto * corner = &corners_[t * 3];
+		return alive_[t] && (corner[0] == to || corner[1] == to || corner[2] == to);
+	});
+}
+
+bool Simplifier::flips(const uint32_t from, const uint32_t to) const
+{
+	// Faces kept by the collapse must not turn over or collapse to a line.
+	for (const auto t: vertexTriangles_[from])
+	{
+		if (!alive_[t] || containsClass(t, classes_[to]))
+		{
+			continue;
+		}
+		const auto before = normal(t, from, from);
+		const auto after = normal(t, from, to);
+		if (glm::dot(before, after) <= 1e-3 * glm::length(before) * glm::length(before))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+double Simplifier::cost(const uint32_t from, const uint32_t to) const
+{
+	const auto quadric = quadrics_[classes_[from]] + quadrics_[classes_[to]];
+	const glm::dvec4 point{positions_[to], 1.0};
+	return std::max(glm::dot(point, quadric * point), 0.0);
+}
+
+glm::dvec3 Simplifier::normal(const uint32_t triangle, const uint32_t from, const uint32_t to) const
+{
+	std::array<glm::dvec3, 3> points;
+	for (int i = 0; i < 3; ++i)
+	{
+		const auto corner = corners_[triangle * 3 + i];
+		points[i] = positions_[corner == from ? to : corner];
+	}
+	return glm::cross(points[1] - points[0], points[2] - points[0]);
+}
+
+void Simplifier::push(const uint32_t from, const uint32_t to)
+{
+	// Seam vertices stay, their attributes differ per face.
+	if (!locked_[from])
+	{
+		queue_.push({cost(from, to), from, to});
+	}
+}
+
+void Simplifier::collapse(const uint32_t from, const uint32_t to)
+{
+	for (const auto t: vertexTriangles_[from])
+	{
+		if (!alive_[t])
+		{
+			continue;
+		}
+		if (containsClass(t, classes_[to]))
+		{
+			alive_[t] = false;
+			--triangles_;
+			continue;
+		}
+		std::replace(corners_.begin() + t * 3, corners_.begin() + t * 3 + 3, from, to);
+		vertexTriangles_[to].push_back(t);
+	}
+	vertexTriangles_[from].clear();
+	quadrics_[classes_[to]] += quadrics_[classes_[from]];
+
+	// Costs of collapses around the merged vertex have changed.
+	auto & triangles = vertexTriangles_[to];
+	std::erase_if(triangles, [&](const uint32_t t) { return !alive_[t]; });
+	for (const auto t: triangles)
+	{
+		for (int i = 0; i < 3; ++i)
+		{
+			const auto corner = corners_[t * 3 + i];
+			if (corner != to)
+			{
+				push(corner, to);
+				push(to, corner);
+			}
+		}
+	}
+}
+
+}// namespace
+
+std::vector<SimplifiedLevel> simplify(const gsl::span<const QVector3D> positions, const gsl::span<const uint32_t> indices,
+									  const size_t levels, const float ratio)
+{
+	std::vector<SimplifiedLevel> result;
+	Simplifier simplifier(positions, indices);
+	auto previous = simplifier.triangles();
+	for (size_t level = 0; level < levels; ++level)
+	{
+		simplifier.reduce(static_cast<size_t>(static_cast<double>(previous) * ratio));
+		if (static_cast<double>(simplifier.triangles()) > static_cast<double>(previous) * g_minReduction)
+		{
+			break;
+		}
+		previous = simplifier.triangles();
+		result.push_back({simplifier.indices(), simplifier.error()});
+	}
+	return result;
+}
+
+}// namespace fgl
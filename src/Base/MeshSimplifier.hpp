@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QVector3D>
+
+#include <gsl/span>
+
+#include <cstdint>
+#include <vector>
+
+namespace fgl
+{
+
+struct SimplifiedLevel {
+	std::vector<uint32_t> indices;
+	// Largest distance to the original surface estimated by quadrics.
+	float error = 0.0f;
+};
+
+// Reduces a triangle list by quadric error metric edge collapses. Vertices
+// are never moved, an edge collapses into one of its ends, so every level
+// indexes the original vertices. Vertices on attribute seams are kept and
+// open borders are penalized to preserve silhouettes. Each level has about
+// ratio of the triangles of the previous one, levels that could not be
+// reduced enough are not returned.
+[[nodiscard]] std::vector<SimplifiedLevel> simplify(gsl::span<const QVector3D> positions, gsl::span<const uint32_t> indices,
+													 size_t levels, float ratio = 0.5f);
+
+}// namespace fgl
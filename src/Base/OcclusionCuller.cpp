@@ -0,0 +1,252 @@
+#include "OcclusionCuller.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Vertices closer to the eye than this are treated as crossing the near plane.
+constexpr float g_minW = 1e-5f;
+
+glm::aligned_vec4 load(const float * values)
+{
+	return {values[0], values[1], values[2], values[3]};
+}
+
+void store(float * values, const glm::aligned_vec4 & value)
+{
+	values[0] = value.x;
+	values[1] = value.y;
+	values[2] = value.z;
+	values[3] = value.w;
+}
+
+glm::aligned_mat4 toGlm(const QMatrix4x4 & matrix)
+{
+	// Both are column-major.
+	return glm::aligned_mat4{glm::make_mat4(matrix.constData())};
+}
+
+}// namespace
+
+OcclusionCuller::OcclusionCuller(const int width, const int height)
+{
+	// Hierarchy halves levels down to a single row or column.
+	auto levelWidth = (std::max(width, 4) + 3) & ~3;
+	auto levelHeight = std::max(height, 1);
+	while (true)
+	{
+		levels_.push_back({levelWidth, levelHeight, std::vector<float>(static_cast<size_t>(levelWidth * levelHeight), 1.0f)});
+		if (levelWidth == 1 || levelHeight == 1)
+		{
+			break;
+		}
+		levelWidth = (levelWidth + 1) / 2;
+		levelHeight = (levelHeight + 1) / 2;
+	}
+}
+
+void OcclusionCuller::begin(const QMatrix4x4 & clip)
+{
+	clip_ = clip;
+	std::fill(levels_.front().depth.begin(), levels_.front().depth.end(), 1.0f);
+	triangles_ = 0;
+}
+
+void OcclusionCuller::drawOccluder(const Occluder & occluder, const QMatrix4x4 & world)
+{
+	const auto & target = levels_.front();
+	const auto transform = toGlm(clip_) * toGlm(world);
+	const glm::aligned_vec4 scale{0.5f * static_cast<float>(target.width), 0.5f * static_cast<float>(target.height), 0.5f, 0.0f};
+
+	projected_.resize(occluder.vertices.size() * 4);
+	for (size_t i = 0; i < occluder.vertices.size(); ++i)
+	{
+		const auto & vertex = occluder.vertices[i];
+		const auto clip = transform * glm::aligned_vec4{vertex.x(), vertex.y(), vertex.z(), 1.0f};
+		if (clip.w < g_minW)
+		{
+			store(&projected_[i * 4], glm::aligned_vec4{0.0f});
+			continue;
+		}
+		// Window coordinates with depth in [0, 1], last component marks valid vertices.
+		auto screen = (clip / clip.w + glm::aligned_vec4{1.0f, 1.0f, 1.0f, 0.0f}) * scale;
+		screen.w = 1.0f;
+		store(&projected_[i * 4], screen);
+	}
+
+	for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+	{
+		const auto * v0 = &projected_[occluder.indices[i] * 4];
+		const auto * v1 = &projected_[occluder.indices[i + 1] * 4];
+		const auto * v2 = &projected_[occluder.indices[i + 2] * 4];
+		if (v0[3] != 0.0f && v1[3] != 0.0f && v2[3] != 0.0f)
+		{
+			drawTriangle(v0, v1, v2);
+		}
+	}
+}
+
+void OcclusionCuller::drawTriangle(const float * v0, const float * v1, const float * v2)
+{
+	auto area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+	if (std::abs(area) < 1e-8f)
+	{
+		return;
+	}
+	// Both windings are drawn, depth test keeps the nearest surface anyway.
+	if (area < 0.0f)
+	{
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	auto & target = levels_.front();
+	const auto minX = std::max(static_cast<int>(std::floor(std::min({v0[0], v1[0], v2[0]}))), 0);
+	const auto maxX = std::min(static_cast<int>(std::ceil(std::max({v0[0], v1[0], v2[0]}))), target.width - 1);
+	const auto minY = std::max(static_cast<int>(std::floor(std::min({v0[1], v1[1], v2[1]}))), 0);
+	const auto maxY = std::min(static_cast<int>(std::ceil(std::max({v0[1], v1[1], v2[1]}))), target.height - 1);
+	if (minX > maxX || minY > maxY)
+	{
+		return;
+	}
+	++triangles_;
+
+	// Edge functions e = a * x + b * y + c are positive inside, each one is
+	// opposite to a vertex and weights its depth.
+	const auto edge = [](const float * from, const float * to) {
+		const auto a = from[1] - to[1];
+		const auto b = to[0] - from[0];
+		return glm::vec3{a, b, -(a * from[0] + b * from[1])};
+	};
+	const auto e0 = edge(v1, v2);
+	const auto e1 = edge(v2, v0);
+	const auto e2 = edge(v0, v1);
+	const auto depth = (e0 * v0[2] + e1 * v1[2] + e2 * v2[2]) / area;
+
+	const glm::aligned_vec4 a{e0.x, e1.x, e2.x, depth.x};
+	const glm::aligned_vec4 zero{0.0f};
+	const glm::aligned_vec4 offsets{0.5f, 1.5f, 2.5f, 3.5f};
+	for (auto y = minY; y <= maxY; ++y)
+	{
+		// Row constants, x terms are added per block of four pixels.
+		const auto py = static_cast<float>(y) + 0.5f;
+		const auto row0 = e0.y * py + e0.z;
+		const auto row1 = e1.y * py + e1.z;
+		const auto row2 = e2.y * py + e2.z;
+		const auto rowDepth = depth.y * py + depth.z;
+		auto * line = &target.depth[static_cast<size_t>(y * target.width)];
+		for (auto x = minX & ~3; x <= maxX; x += 4)
+		{
+			const auto px = glm::aligned_vec4{static_cast<float>(x)} + offsets;
+			const auto inside = glm::greaterThanEqual(px * a.x + row0, zero)
+								&& glm::greaterThanEqual(px * a.y + row1, zero)
+								&& glm::greaterThanEqual(px * a.z + row2, zero);
+			if (!glm::any(inside))
+			{
+				continue;
+			}
+			const auto current = load(line + x);
+			const auto z = glm::clamp(px * a.w + rowDepth, zero, glm::aligned_vec4{1.0f});
+			store(line + x, glm::mix(current, glm::min(current, z), inside));
+		}
+	}
+}
+
+void OcclusionCuller::finish()
+{
+	// Every texel keeps the farthest depth of the four below it.
+	for (size_t i = 1; i < levels_.size(); ++i)
+	{
+		const auto & source = levels_[i - 1];
+		auto & level = levels_[i];
+		for (int y = 0; y < level.height; ++y)
+		{
+			const auto y0 = std::min(2 * y, source.height - 1) * source.width;
+			const auto y1 = std::min(2 * y + 1, source.height - 1) * source.width;
+			for (int x = 0; x < level.width; ++x)
+			{
+				const auto x0 = std::min(2 * x, source.width - 1);
+				const auto x1 = std::min(2 * x + 1, source.width - 1);
+				level.depth[static_cast<size_t>(y * level.width + x)] = std::max(
+					{source.depth[static_cast<size_t>(y0 + x0)], source.depth[static_cast<size_t>(y0 + x1)],
+					 source.depth[static_cast<size_t>(y1 + x0)], source.depth[static_cast<size_t>(y1 + x1)]});
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::isOccluded(const Bounds & bounds) const
+{
+	if (!triangles_ || !bounds.valid)
+	{
+		return false;
+	}
+
+	// Screen rectangle and nearest depth of the box corners.
+	const auto clip = toGlm(clip_);
+	glm::aligned_vec4 lower{std::numeric_limits<float>::max()};
+	glm::aligned_vec4 upper{std::numeric_limits<float>::lowest()};
+	for (int i = 0; i < 8; ++i)
+	{
+		const glm::aligned_vec4 corner{(i & 1 ? bounds.max : bounds.min).x(), (i & 2 ? bounds.max : bounds.min).y(),
+									   (i & 4 ? bounds.max : bounds.min).z(), 1.0f};
+		const auto projected = clip * corner;
+		if (projected.w < g_minW)
+		{
+			// Boxes crossing the near plane are never hidden.
+			return false;
+		}
+		const auto ndc = projected / projected.w;
+		lower = glm::min(lower, ndc);
+		upper = glm::max(upper, ndc);
+	}
+
+	const auto & base = levels_.front();
+	const auto width = static_cast<float>(base.width);
+	const auto height = static_cast<float>(base.height);
+	auto x0 = static_cast<int>(std::floor((lower.x * 0.5f + 0.5f) * width));
+	auto x1 = static_cast<int>(std::floor((upper.x * 0.5f + 0.5f) * width));
+	auto y0 = static_cast<int>(std::floor((lower.y * 0.5f + 0.5f) * height));
+	auto y1 = static_cast<int>(std::floor((upper.y * 0.5f + 0.5f) * height));
+	x0 = std::clamp(x0, 0, base.width - 1);
+	x1 = std::clamp(x1, 0, base.width - 1);
+	y0 = std::clamp(y0, 0, base.height - 1);
+	y1 = std::clamp(y1, 0, base.height - 1);
+	const auto nearest = lower.z * 0.5f + 0.5f;
+
+	// Coarsest level where the rectangle spans at most two texels per axis.
+	size_t level = 0;
+	while (level + 1 < levels_.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+	{
+		++level;
+	}
+	const auto & hiz = levels_[level];
+	for (auto y = y0 >> level; y <= (y1 >> level); ++y)
+	{
+		for (auto x = x0 >> level; x <= (x1 >> level); ++x)
+		{
+			if (nearest <= hiz.depth[static_cast<size_t>(y * hiz.width + x)])
+			{
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+size_t OcclusionCuller::triangles() const noexcept
+{
+	return triangles_;
+}
+
+}// namespace fgl
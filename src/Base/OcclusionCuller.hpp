@@ -0,0 +1,54 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <QMatrix4x4>
+
+#include <vector>
+
+namespace fgl
+{
+
+// Occlusion culling against a low resolution software depth buffer. Large
+// occluders are rasterized on the CPU four pixels at a time, then a
+// hierarchical-Z chain of farthest depths is built and bounds are tested
+// against the level where they cover at most 2x2 texels. Needs no GPU
+// queries, so it stays cheap on software drivers like llvmpipe.
+class OcclusionCuller final
+{
+public:
+	// Width is rounded up to a multiple of four.
+	explicit OcclusionCuller(int width = 256, int height = 128);
+
+	// Clears depth, clip maps scene world space to clip space.
+	void begin(const QMatrix4x4 & clip);
+	// Triangles crossing the near plane are skipped.
+	void drawOccluder(const Occluder & occluder, const QMatrix4x4 & world);
+	// Builds hierarchical depth from occluders drawn since begin().
+	void finish();
+
+	// Whether world space bounds are hidden behind drawn occluders.
+	[[nodiscard]] bool isOccluded(const Bounds & bounds) const;
+
+	// Occluder triangles rasterized since begin().
+	[[nodiscard]] size_t triangles() const noexcept;
+
+private:
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<float> depth;
+	};
+
+	void drawTriangle(const float * v0, const float * v1, const float * v2);
+
+private:
+	QMatrix4x4 clip_;
+	// Level zero is the rasterized depth, rows are bottom up.
+	std::vector<Level> levels_;
+	// Screen x, y, depth and a visibility flag per occluder vertex.
+	std::vector<float> projected_;
+	size_t triangles_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,170 @@
+#include "OffscreenRunner.hpp"
+
+#include "GLWidget.hpp"
+
+#include <QElapsedTimer>
+#include <QJsonArray>
+#include <QOpenGLFramebufferObjectFormat>
+#include <QOpenGLFunctions>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+namespace
+{
+
+QJsonObject percentilesToJson(const FrameProfiler::Percentiles & percentiles)
+{
+	QJsonObject result;
+	result.insert("p50", percentiles.p50);
+	result.insert("p95", percentiles.p95);
+	result.insert("p99", percentiles.p99);
+	return result;
+}
+
+}// namespace
+
+QJsonObject OffscreenRunner::Result::toJson() const
+{
+	QJsonArray phases;
+	for (const auto & phase: report.phases)
+	{
+		QJsonObject item;
+		item.insert("name", QString::fromStdString(phase.name));
+		item.insert("depth", static_cast<int>(phase.depth));
+		item.insert("cpuMs", percentilesToJson(phase.cpu));
+		if (phase.hasGpu)
+		{
+			item.insert("gpuMs", percentilesToJson(phase.gpu));
+		}
+		phases.append(item);
+	}
+
+	QJsonObject result;
+	result.insert("renderer", renderer);
+	result.insert("version", version);
+	result.insert("width", static_cast<int>(settings.width));
+	result.insert("height", static_cast<int>(settings.height));
+	result.insert("samples", settings.samples);
+	result.insert("frames", static_cast<int>(report.frames));
+	result.insert("warmupFrames", static_cast<int>(settings.warmupFrames));
+	result.insert("totalMs", totalMs);
+	result.insert("framesPerSecond", totalMs > 0.0 ? 1000.0 * static_cast<double>(report.frames) / totalMs : 0.0);
+	result.insert("frameMs", percentilesToJson(report.frame));
+	result.insert("phases", phases);
+
+	QJsonObject counters;
+	for (const auto & counter: report.counters)
+	{
+		counters.insert(QString::fromStdString(counter.name), percentilesToJson(counter.values));
+	}
+	result.insert("counters", counters);
+	return result;
+}
+
+OffscreenRunner::OffscreenRunner(const Settings & settings)
+	: settings_{settings}
+{
+	surface_.setFormat(QSurfaceFormat::defaultFormat());
+	surface_.create();
+
+	context_.setFormat(QSurfaceFormat::defaultFormat());
+	if (!surface_.isValid() || !context_.create() || !context_.makeCurrent(&surface_))
+	{
+		return;
+	}
+
+	GLint maxSamples = 0;
+	context_.functions()->glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+	settings_.samples = std::clamp(settings_.samples, 0, static_cast<int>(maxSamples));
+
+	const QSize size{static_cast<int>(settings_.width), static_cast<int>(settings_.height)};
+
+	QOpenGLFramebufferObjectFormat format;
+	format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+	format.setSamples(settings_.samples);
+	fbo_ = std::make_unique<QOpenGLFramebufferObject>(size, format);
+
+	resolved_ = std::make_unique<QOpenGLFramebufferObject>(size, QOpenGLFramebufferObjectFormat{});
+}
+
+OffscreenRunner::~OffscreenRunner()
+{
+	if (context_.isValid())
+	{
+		context_.makeCurrent(&surface_);
+		resolved_.reset();
+		fbo_.reset();
+		context_.doneCurrent();
+	}
+}
+
+bool OffscreenRunner::isValid() const noexcept
+{
+	return fbo_ && fbo_->isValid() && resolved_ && resolved_->isValid();
+}
+
+auto OffscreenRunner::run(GLWidget & widget) -> Result
+{
+	Result result;
+	result.settings = settings_;
+	if (!isValid())
+	{
+		return result;
+	}
+
+	context_.makeCurrent(&surface_);
+
+	auto * functions = context_.functions();
+	result.renderer = reinterpret_cast<const char *>(functions->glGetString(GL_RENDERER));
+	result.version = reinterpret_cast<const char *>(functions->glGetString(GL_VERSION));
+
+	fbo_->bind();
+	widget.initializeFunctions();
+	widget.onInit();
+	widget.onResize(settings_.width, settings_.height);
+
+	auto & profiler = widget.profiler();
+
+	const auto renderFrame = [&] {
+		profiler.beginFrame();
+		fbo_->bind();
+		widget.render();
+		{
+			// Resolve and wait for the frame as a swap would.
+			const auto scope = profiler.scope("swap");
+			QOpenGLFramebufferObject::blitFramebuffer(resolved_.get(), fbo_.get());
+			functions->glFinish();
+		}
+		profiler.endFrame();
+	};
+
+	// Frames rendered while assets stream in are not measured.
+	while (widget.isLoading())
+	{
+		renderFrame();
+	}
+	for (size_t i = 0; i < settings_.warmupFrames; ++i)
+	{
+		renderFrame();
+	}
+	profiler.reset(settings_.frames);
+
+	QElapsedTimer timer;
+	timer.start();
+	for (size_t i = 0; i < settings_.frames; ++i)
+	{
+		renderFrame();
+	}
+	result.totalMs = static_cast<double>(timer.nsecsElapsed()) / 1000000.0;
+
+	profiler.flush();
+	result.report = profiler.report();
+
+	fbo_->release();
+	return result;
+}
+
+}// namespace fgl
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "FrameProfiler.hpp"
+
+#include <QJsonObject>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QString>
+
+#include <memory>
+
+namespace fgl
+{
+
+class GLWidget;
+
+// Renders a GLWidget into an offscreen framebuffer without showing it.
+// The context stays current for the lifetime of the runner, so widgets
+// rendered by it have to be destroyed before it.
+class OffscreenRunner final
+{
+public:
+	struct Settings {
+		size_t width = 1280;
+		size_t height = 720;
+		int samples = 0;
+		size_t frames = 1000;
+		size_t warmupFrames = 60;
+	};
+
+	struct Result {
+		Settings settings;
+		QString renderer;
+		QString version;
+		double totalMs = 0.0;
+		FrameProfiler::Report report;
+
+		[[nodiscard]] QJsonObject toJson() const;
+	};
+
+public:
+	explicit OffscreenRunner(const Settings & settings);
+	~OffscreenRunner();
+
+	OffscreenRunner(const OffscreenRunner &) = delete;
+	OffscreenRunner(OffscreenRunner &&) = delete;
+	OffscreenRunner & operator=(const OffscreenRunner &) = delete;
+	OffscreenRunner & operator=(OffscreenRunner &&) = delete;
+
+	[[nodiscard]] bool isValid() const noexcept;
+
+	[[nodiscard]] Result run(GLWidget & widget);
+
+private:
+	Settings settings_;
+
+	QOffscreenSurface surface_;
+	QOpenGLContext context_;
+
+	// Multisampled target and its resolved copy, like a window back buffer.
+	std::unique_ptr<QOpenGLFramebufferObject> fbo_;
+	std::unique_ptr<QOpenGLFramebufferObject> resolved_;
+};
+
+}// namespace fgl
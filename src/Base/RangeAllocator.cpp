@@ -0,0 +1,88 @@
+#include "RangeAllocator.hpp"
+
+#include <iterator>
+
+namespace fgl
+{
+
+RangeAllocator::RangeAllocator(const size_t capacity)
+{
+	grow(capacity);
+}
+
+size_t RangeAllocator::allocate(const size_t size, const size_t alignment)
+{
+	for (auto it = free_.begin(); it != free_.end(); ++it)
+	{
+		const auto [offset, length] = *it;
+		const auto aligned = (offset + alignment - 1) / alignment * alignment;
+		if (aligned + size > offset + length)
+		{
+			continue;
+		}
+		free_.erase(it);
+		if (aligned > offset)
+		{
+			free_.emplace(offset, aligned - offset);
+		}
+		if (aligned + size < offset + length)
+		{
+			free_.emplace(aligned + size, offset + length - aligned - size);
+		}
+		used_ += size;
+		return aligned;
+	}
+	return invalid;
+}
+
+void RangeAllocator::free(const size_t offset, const size_t size)
+{
+	if (!size)
+	{
+		return;
+	}
+	used_ -= size;
+	insert(offset, size);
+}
+
+void RangeAllocator::grow(const size_t capacity)
+{
+	if (capacity > capacity_)
+	{
+		insert(capacity_, capacity - capacity_);
+		capacity_ = capacity;
+	}
+}
+
+size_t RangeAllocator::capacity() const noexcept
+{
+	return capacity_;
+}
+
+size_t RangeAllocator::used() const noexcept
+{
+	return used_;
+}
+
+void RangeAllocator::insert(size_t offset, size_t size)
+{
+	auto next = free_.lower_bound(offset);
+	if (next != free_.begin())
+	{
+		const auto previous = std::prev(next);
+		if (previous->first + previous->second == offset)
+		{
+			offset = previous->first;
+			size += previous->second;
+			free_.erase(previous);
+		}
+	}
+	if (next != free_.end() && offset + size == next->first)
+	{
+		size += next->second;
+		free_.erase(next);
+	}
+	free_.emplace(offset, size);
+}
+
+}// namespace fgl
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <map>
+
+namespace fgl
+{
+
+// First fit allocator of ranges in [0, capacity), in any units. Free ranges
+// are kept by offset and merged with their neighbours when freed, so
+// repeated loads and unloads do not fragment the space more than needed.
+class RangeAllocator final
+{
+public:
+	static constexpr size_t invalid = std::numeric_limits<size_t>::max();
+
+	explicit RangeAllocator(size_t capacity = 0);
+
+	// Returns offset of the range or invalid when no free range fits.
+	// Padding skipped for alignment stays free.
+	[[nodiscard]] size_t allocate(size_t size, size_t alignment = 1);
+	// Range has to be allocated before.
+	void free(size_t offset, size_t size);
+	// Appends free space at the end.
+	void grow(size_t capacity);
+
+	[[nodiscard]] size_t capacity() const noexcept;
+	[[nodiscard]] size_t used() const noexcept;
+
+private:
+	void insert(size_t offset, size_t size);
+
+private:
+	// Offset to size of free ranges.
+	std::map<size_t, size_t> free_;
+	size_t capacity_ = 0;
+	size_t used_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,147 @@
+#include "RenderQueue.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr quint64 field(const quint64 value, const int bits)
+{
+	return value & ((quint64{1} << bits) - 1);
+}
+
+GLuint indexSize(const GLenum type)
+{
+	return type == GL_UNSIGNED_BYTE ? 1 : (type == GL_UNSIGNED_SHORT ? 2 : 4);
+}
+
+}// namespace
+
+quint64 RenderQueue::makeKey(const uint32_t program, const uint32_t material, const uint32_t texture,
+							 const uint32_t vertexArray, const float depth)
+{
+	constexpr auto depthMax = (quint64{1} << depthBits) - 1;
+	const auto quantizedDepth = static_cast<quint64>(std::clamp(depth, 0.0f, 1.0f) * static_cast<float>(depthMax));
+
+	auto key = field(program, programBits);
+	key = (key << materialBits) | field(material, materialBits);
+	key = (key << textureBits) | field(texture, textureBits);
+	key = (key << vertexArrayBits) | field(vertexArray, vertexArrayBits);
+	key = (key << depthBits) | quantizedDepth;
+	return key;
+}
+
+void RenderQueue::initialize()
+{
+	// Version functions are only available for contexts of that version.
+	indirect_ = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_3_Core>();
+	if (indirect_ && !indirect_->initializeOpenGLFunctions())
+	{
+		indirect_ = nullptr;
+	}
+	if (indirect_)
+	{
+		commandStream_.initialize();
+	}
+}
+
+void RenderQueue::release()
+{
+	if (indirect_)
+	{
+		commandStream_.release();
+		indirect_ = nullptr;
+	}
+}
+
+bool RenderQueue::isIndirect() const noexcept
+{
+	return indirect_ != nullptr;
+}
+
+void RenderQueue::setInstanceIndices(const GLuint attribute, const GLuint buffer)
+{
+	instanceAttribute_ = attribute;
+	instanceBuffer_ = buffer;
+}
+
+void RenderQueue::clear()
+{
+	entries_.clear();
+	packets_.clear();
+}
+
+void RenderQueue::push(const quint64 key, const DrawPacket & packet)
+{
+	entries_.push_back({key, static_cast<uint32_t>(packets_.size())});
+	packets_.push_back(packet);
+}
+
+void RenderQueue::sort()
+{
+	commandsUploaded_ = false;
+	// Only small entries are moved, packets stay in submission order.
+	std::sort(entries_.begin(), entries_.end(), [](const auto & lhs, const auto & rhs) { return lhs.key < rhs.key; });
+}
+
+void RenderQueue::fence()
+{
+	if (commandsWritten_)
+	{
+		commandStream_.fence();
+		commandsWritten_ = false;
+	}
+}
+
+size_t RenderQueue::size() const noexcept
+{
+	return entries_.size();
+}
+
+size_t RenderQueue::stalls() const noexcept
+{
+	return commandStream_.stalls();
+}
+
+bool RenderQueue::batches(const DrawPacket & lhs, const DrawPacket & rhs)
+{
+	return lhs.program == rhs.program && lhs.material == rhs.material && lhs.texture == rhs.texture && lhs.vao == rhs.vao
+		&& lhs.mode == rhs.mode && lhs.indexType == rhs.indexType && rhs.indexType;
+}
+
+bool RenderQueue::uploadCommands(InstrumentedFunctions & gl)
+{
+	// Non-indexed packets keep unused commands, so commands match entries.
+	commands_.clear();
+	for (const auto & entry: entries_)
+	{
+		const auto & packet = packets_[entry.packet];
+		const auto firstIndex = packet.indexType ? static_cast<GLuint>(packet.indexOffset / indexSize(packet.indexType)) : 0;
+		commands_.push_back({static_cast<GLuint>(packet.count), static_cast<GLuint>(packet.instances), firstIndex, packet.baseVertex,
+							 packet.firstInstance});
+	}
+
+	const auto size = commands_.size() * sizeof(DrawElementsIndirectCommand);
+	commandStream_.begin(size);
+	const auto allocation = commandStream_.allocate(size, sizeof(GLuint));
+	if (allocation.data)
+	{
+		std::memcpy(allocation.data, commands_.data(), size);
+		gl.countUpload(size);
+	}
+	commandStream_.finish();
+	if (!allocation.data)
+	{
+		return false;
+	}
+	commandOffset_ = allocation.offset;
+	return true;
+}
+
+}// namespace fgl
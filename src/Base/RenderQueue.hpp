@@ -0,0 +1,232 @@
+#pragma once
+
+#include "InstrumentedFunctions.hpp"
+#include "StreamBuffer.hpp"
+
+#include <QOpenGLShaderProgram>
+#include <QOpenGLTexture>
+#include <QOpenGLVertexArrayObject>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fgl
+{
+
+struct DrawPacket {
+	QOpenGLShaderProgram * program = nullptr;
+	QOpenGLVertexArrayObject * vao = nullptr;
+	QOpenGLTexture * texture = nullptr;
+	GLenum mode = GL_TRIANGLES;
+	GLsizei count = 0;
+	// Zero for non-indexed draws.
+	GLenum indexType = 0;
+	size_t indexOffset = 0;
+	// Added to indices, or the first vertex of non-indexed draws.
+	GLint baseVertex = 0;
+	// Instanced draw is used for more than one instance.
+	GLsizei instances = 1;
+	// Value of the instance index attribute for the first instance, see
+	// RenderQueue::setInstanceIndices().
+	GLuint firstInstance = 0;
+	// Passed back to submit() callbacks to set uniforms.
+	uint32_t material = 0;
+};
+
+// Collects draw packets, sorts them by a 64-bit state key and submits them
+// binding only what changed between neighbours. Nothing is released between
+// draws, bindings are reset once after the last one. Packets sharing a
+// vertex array only differ in base vertex, offsets and first instance.
+//
+// With GL 4.3 indexed packets become indirect commands written into a
+// stream buffer, runs of neighbours sharing all state are drawn by one
+// glMultiDrawElementsIndirect(). Otherwise packets are drawn one by one.
+class RenderQueue final
+{
+public:
+	// Key fields from the most significant bits: program, material, texture,
+	// vertex array and depth. Ids are truncated to their field widths.
+	static constexpr int programBits = 8;
+	static constexpr int materialBits = 14;
+	static constexpr int textureBits = 14;
+	static constexpr int vertexArrayBits = 14;
+	static constexpr int depthBits = 14;
+	static_assert(programBits + materialBits + textureBits + vertexArrayBits + depthBits == 64);
+
+	// Depth is in [0, 1], smaller values are drawn first.
+	[[nodiscard]] static quint64 makeKey(uint32_t program, uint32_t material, uint32_t texture, uint32_t vertexArray, float depth);
+
+public:
+	// Both require a bound context. Indirect draws are used when it has
+	// GL 4.3 functions.
+	void initialize();
+	void release();
+
+	[[nodiscard]] bool isIndirect() const noexcept;
+
+	// Instance index attribute read from buffer of consecutive integers, as
+	// GL 3.3 has no base instance. It is pointed to the first instance of a
+	// packet before its draw, so instanced data can be fetched by index.
+	// Indirect draws pass first instances as base instances instead.
+	void setInstanceIndices(GLuint attribute, GLuint buffer);
+
+	void clear();
+	void push(quint64 key, const DrawPacket & packet);
+	void sort();
+
+	[[nodiscard]] size_t size() const noexcept;
+	// Waits of the indirect command stream this frame, see
+	// StreamBuffer::stalls().
+	[[nodiscard]] size_t stalls() const noexcept;
+
+	// Draws sorted packets. setProgram(program) is called after a program is
+	// bound, setMaterial(program, material) before draws whose material
+	// differs from the previous draw. Packets are drawn with override when
+	// set, so the same packets can be drawn again into another target.
+	// Commands are streamed once per sort().
+	template<class SetProgram, class SetMaterial>
+	void submit(InstrumentedFunctions & gl, SetProgram && setProgram, SetMaterial && setMaterial,
+				QOpenGLShaderProgram * override = nullptr);
+	// Call after the last submit() of a frame.
+	void fence();
+
+private:
+	struct Entry {
+		quint64 key = 0;
+		uint32_t packet = 0;
+	};
+
+	// Packets drawn by a single indirect draw.
+	[[nodiscard]] static bool batches(const DrawPacket & lhs, const DrawPacket & rhs);
+	// Writes commands of sorted packets, false when there is nothing to
+	// draw.
+	[[nodiscard]] bool uploadCommands(InstrumentedFunctions & gl);
+
+	std::vector<Entry> entries_;
+	std::vector<DrawPacket> packets_;
+	GLuint instanceAttribute_ = 0;
+	GLuint instanceBuffer_ = 0;
+
+	QOpenGLFunctions_4_3_Core * indirect_ = nullptr;
+	StreamBuffer commandStream_;
+	std::vector<DrawElementsIndirectCommand> commands_;
+	size_t commandOffset_ = 0;
+	bool commandsUploaded_ = false;
+	bool commandsWritten_ = false;
+};
+
+template<class SetProgram, class SetMaterial>
+void RenderQueue::submit(InstrumentedFunctions & gl, SetProgram && setProgram, SetMaterial && setMaterial,
+						 QOpenGLShaderProgram * const override)
+{
+	if (indirect_ && !commandsUploaded_)
+	{
+		commandsWritten_ = uploadCommands(gl);
+		commandsUploaded_ = true;
+	}
+	const auto indirect = indirect_ && commandsWritten_;
+	if (indirect)
+	{
+		gl.glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandStream_.buffer());
+	}
+	QOpenGLShaderProgram * program = nullptr;
+	QOpenGLVertexArrayObject * vao = nullptr;
+	QOpenGLTexture * texture = nullptr;
+	const DrawPacket * previous = nullptr;
+	GLuint instanceOffset = 0;
+	for (size_t i = 0; i < entries_.size();)
+	{
+		const auto & packet = packets_[entries_[i].packet];
+		const auto programChanged = (override ? override : packet.program) != program;
+		if (programChanged)
+		{
+			program = override ? override : packet.program;
+			gl.bind(*program);
+			setProgram(*program);
+		}
+		if (programChanged || packet.material != previous->material)
+		{
+			setMaterial(*program, packet.material);
+		}
+		if (packet.texture != texture)
+		{
+			texture = packet.texture;
+			gl.bind(*texture);
+		}
+		const auto vaoChanged = packet.vao != vao;
+		if (vaoChanged)
+		{
+			vao = packet.vao;
+			gl.bind(*vao);
+		}
+		const auto multiDraw = indirect && packet.indexType;
+		const auto firstInstance = multiDraw ? 0 : packet.firstInstance;
+		if (instanceBuffer_ && (vaoChanged || firstInstance != instanceOffset))
+		{
+			instanceOffset = firstInstance;
+			gl.glBindBuffer(GL_ARRAY_BUFFER, instanceBuffer_);
+			gl.glVertexAttribIPointer(instanceAttribute_, 1, GL_UNSIGNED_INT, 0, reinterpret_cast<const void *>(instanceOffset * sizeof(GLuint)));
+		}
+
+		if (multiDraw)
+		{
+			auto end = i + 1;
+			while (end < entries_.size() && batches(packet, packets_[entries_[end].packet]))
+			{
+				++end;
+			}
+			const auto commands = gsl::span<const DrawElementsIndirectCommand>{commands_}.subspan(i, end - i);
+			gl.multiDrawElementsIndirect(*indirect_, packet.mode, packet.indexType, commandOffset_ + i * sizeof(DrawElementsIndirectCommand), commands);
+			previous = &packets_[entries_[end - 1].packet];
+			i = end;
+			continue;
+		}
+
+		const auto * indices = reinterpret_cast<const void *>(packet.indexOffset);
+		if (packet.instances != 1)
+		{
+			if (packet.indexType)
+			{
+				gl.glDrawElementsInstancedBaseVertex(packet.mode, packet.count, packet.indexType, indices, packet.instances, packet.baseVertex);
+			}
+			else
+			{
+				gl.glDrawArraysInstanced(packet.mode, packet.baseVertex, packet.count, packet.instances);
+			}
+		}
+		else if (packet.indexType)
+		{
+			gl.glDrawElementsBaseVertex(packet.mode, packet.count, packet.indexType, indices, packet.baseVertex);
+		}
+		else
+		{
+			gl.glDrawArrays(packet.mode, packet.baseVertex, packet.count);
+		}
+		previous = &packet;
+		++i;
+	}
+
+	if (indirect)
+	{
+		gl.glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	}
+	if (instanceBuffer_)
+	{
+		gl.glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+	if (vao)
+	{
+		vao->release();
+	}
+	if (texture)
+	{
+		texture->release();
+	}
+	if (program)
+	{
+		program->release();
+	}
+}
+
+}// namespace fgl
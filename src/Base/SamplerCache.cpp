@@ -0,0 +1,75 @@
+#include "SamplerCache.hpp"
+
+#include <QOpenGLContext>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+void SamplerCache::initialize()
+{
+	initializeOpenGLFunctions();
+	maxAnisotropy_ = 1.0f;
+	if (QOpenGLContext::currentContext()->hasExtension("GL_EXT_texture_filter_anisotropic"))
+	{
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy_);
+	}
+}
+
+void SamplerCache::release()
+{
+	for (const auto & [policy, sampler]: samplers_)
+	{
+		glDeleteSamplers(1, &sampler);
+	}
+	samplers_.clear();
+}
+
+GLuint SamplerCache::sampler(const SamplerPolicy & policy)
+{
+	// Materials use a handful of policies, a linear search is enough.
+	const auto found = std::find_if(samplers_.begin(), samplers_.end(), [&](const auto & entry) { return entry.first == policy; });
+	if (found != samplers_.end())
+	{
+		return found->second;
+	}
+
+	GLuint sampler = 0;
+	glGenSamplers(1, &sampler);
+	switch (policy.filter)
+	{
+		case SamplerPolicy::Filter::Nearest:
+			glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+			glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+			break;
+		case SamplerPolicy::Filter::Bilinear:
+			glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			break;
+		case SamplerPolicy::Filter::Trilinear:
+			glSamplerParameteri(sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+			glSamplerParameteri(sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			if (maxAnisotropy_ > 1.0f)
+			{
+				glSamplerParameterf(sampler, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::clamp(policy.anisotropy, 1.0f, maxAnisotropy_));
+			}
+			break;
+	}
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_S, static_cast<GLint>(policy.wrapS));
+	glSamplerParameteri(sampler, GL_TEXTURE_WRAP_T, static_cast<GLint>(policy.wrapT));
+	samplers_.emplace_back(policy, sampler);
+	return sampler;
+}
+
+float SamplerCache::maxAnisotropy() const noexcept
+{
+	return maxAnisotropy_;
+}
+
+size_t SamplerCache::size() const noexcept
+{
+	return samplers_.size();
+}
+
+}// namespace fgl
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace fgl
+{
+
+// How a material samples its textures.
+struct SamplerPolicy {
+	enum class Filter : uint8_t
+	{
+		Nearest,
+		Bilinear,
+		// Linear between mip levels, the only one using anisotropy.
+		Trilinear,
+	};
+
+	Filter filter = Filter::Trilinear;
+	// Clamped to what the driver supports.
+	float anisotropy = 8.0f;
+	GLenum wrapS = GL_REPEAT;
+	GLenum wrapT = GL_REPEAT;
+
+	bool operator==(const SamplerPolicy &) const = default;
+};
+
+// Sampler objects shared by all textures, one per distinct policy. Samplers
+// bound to a unit override parameters of textures bound there, so textures
+// only have to carry their mip chains.
+class SamplerCache final : protected QOpenGLExtraFunctions
+{
+public:
+	SamplerCache() = default;
+
+	SamplerCache(const SamplerCache &) = delete;
+	SamplerCache(SamplerCache &&) = delete;
+	SamplerCache & operator=(const SamplerCache &) = delete;
+	SamplerCache & operator=(SamplerCache &&) = delete;
+
+	// Both require a bound context.
+	void initialize();
+	void release();
+
+	// Creates the sampler on first use. Requires a bound context.
+	[[nodiscard]] GLuint sampler(const SamplerPolicy & policy);
+
+	// One when anisotropic filtering is not supported.
+	[[nodiscard]] float maxAnisotropy() const noexcept;
+	[[nodiscard]] size_t size() const noexcept;
+
+private:
+	std::vector<std::pair<SamplerPolicy, GLuint>> samplers_;
+	float maxAnisotropy_ = 1.0f;
+};
+
+}// namespace fgl
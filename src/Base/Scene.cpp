@@ -0,0 +1,81 @@
+#include "Scene.hpp"
+
+#include <algorithm>
+#include <array>
+
+namespace fgl
+{
+
+void Bounds::extend(const QVector3D & point)
+{
+	if (!valid)
+	{
+		min = point;
+		max = point;
+		valid = true;
+		return;
+	}
+	for (int i = 0; i < 3; ++i)
+	{
+		min[i] = std::min(min[i], point[i]);
+		max[i] = std::max(max[i], point[i]);
+	}
+}
+
+void Bounds::extend(const Bounds & other)
+{
+	if (other.valid)
+	{
+		extend(other.min);
+		extend(other.max);
+	}
+}
+
+Bounds Bounds::transformed(const QMatrix4x4 & transform) const
+{
+	Bounds result;
+	if (!valid)
+	{
+		return result;
+	}
+	const std::array<QVector3D, 2> corners{min, max};
+	for (size_t i = 0; i < 8; ++i)
+	{
+		result.extend(transform.map(QVector3D{corners[i & 1].x(), corners[(i >> 1) & 1].y(), corners[(i >> 2) & 1].z()}));
+	}
+	return result;
+}
+
+QVector3D Bounds::center() const
+{
+	return (min + max) * 0.5f;
+}
+
+float Bounds::radius() const
+{
+	return (max - min).length() * 0.5f;
+}
+
+void Scene::addTexture(PackedTexture packed)
+{
+	const auto index = static_cast<int>(textures.size());
+	for (const auto & [image, layer]: packed.layers)
+	{
+		if (image < images.size())
+		{
+			images[image] = {index, layer};
+		}
+	}
+	textures.push_back(std::move(packed.texture));
+}
+
+void Scene::addTiled(const size_t image, TiledImage tiled)
+{
+	if (image < images.size())
+	{
+		images[image].tiled = static_cast<int>(tiledImages.size());
+		tiledImages.push_back(std::move(tiled));
+	}
+}
+
+}// namespace fgl
@@ -0,0 +1,127 @@
+#pragma once
+
+#include "GeometryArena.hpp"
+#include "SamplerCache.hpp"
+#include "TexturePacker.hpp"
+#include "TiledImage.hpp"
+
+#include <QMatrix4x4>
+#include <QOpenGLTexture>
+#include <QVector3D>
+#include <QVector4D>
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// Axis aligned bounding box.
+struct Bounds {
+	QVector3D min;
+	QVector3D max;
+	bool valid = false;
+
+	void extend(const QVector3D & point);
+	void extend(const Bounds & other);
+
+	[[nodiscard]] Bounds transformed(const QMatrix4x4 & transform) const;
+	[[nodiscard]] QVector3D center() const;
+	[[nodiscard]] float radius() const;
+};
+
+// Vertex attribute locations shared by meshes and shaders.
+enum class Attribute : GLuint
+{
+	Position = 0,
+	Normal = 1,
+	TexCoord = 2,
+	Color = 3,
+	// Per instance index of the instance record, see GeometryArena.
+	Instance = 4,
+};
+
+// Simplified index list of a primitive.
+struct Lod {
+	GLsizei count = 0;
+	size_t indexOffset = 0;
+	// Object space distance the level deviates from the full mesh by.
+	float error = 0.0f;
+};
+
+struct Primitive {
+	GLenum mode = GL_TRIANGLES;
+	GLsizei count = 0;
+	// Zero for non-indexed primitives.
+	GLenum indexType = 0;
+	// Byte offset in the index buffer of Scene::geometry.
+	size_t indexOffset = 0;
+	int material = -1;
+	Bounds bounds;
+	// Coarser levels in the same index buffer, from the finest one.
+	std::vector<Lod> lods;
+	// Vertices and indices in Scene::geometry.
+	GeometryArena::Range geometry;
+	// Stored positions are multiplied by xyz of the scale and moved by xyz
+	// of the offset. Decoded normals are multiplied by w of the scale and w
+	// of the offset is added to colors, so missing normals and colors drop
+	// out. Passed with every instance.
+	std::array<float, 4> dequantizeScale{1.0f, 1.0f, 1.0f, 1.0f};
+	std::array<float, 4> dequantizeOffset{};
+};
+
+// CPU copy of mesh triangles drawn into the software depth buffer of
+// OcclusionCuller. Empty for meshes too detailed to be worth rasterizing.
+struct Occluder {
+	std::vector<QVector3D> vertices;
+	std::vector<uint32_t> indices;
+};
+
+struct Mesh {
+	std::vector<Primitive> primitives;
+	Bounds bounds;
+	Occluder occluder;
+};
+
+struct Material {
+	QVector4D baseColor{1.0f, 1.0f, 1.0f, 1.0f};
+	int baseColorTexture = -1;
+	SamplerPolicy sampler;
+};
+
+// Where an image was uploaded.
+struct ImageTexture {
+	// Index in Scene::textures, -1 until the image is uploaded.
+	int texture = -1;
+	int layer = 0;
+	// Index in Scene::tiledImages for images left to a virtual texture.
+	int tiled = -1;
+};
+
+struct Node {
+	QMatrix4x4 world;
+	size_t mesh = 0;
+};
+
+// GPU side of a loaded model, has to be destroyed with a bound context.
+struct Scene {
+	// Instance attribute values cover every primitive of every node.
+	GeometryArena geometry{static_cast<GLuint>(Attribute::Instance)};
+	// 2D arrays, small images of the same size and format share one.
+	std::vector<std::unique_ptr<QOpenGLTexture>> textures;
+	// By glTF image.
+	std::vector<ImageTexture> images;
+	std::vector<TiledImage> tiledImages;
+	std::vector<Material> materials;
+	std::vector<Mesh> meshes;
+	std::vector<Node> nodes;
+	Bounds bounds;
+
+	// Takes the texture and points its images to their layers.
+	void addTexture(PackedTexture packed);
+	void addTiled(size_t image, TiledImage tiled);
+};
+
+}// namespace fgl
@@ -0,0 +1,297 @@
+#include "SceneBvh.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_aligned.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr uint32_t g_leafSize = 4;
+
+// Four frustum planes in SoA layout, tested against a box at once.
+struct PlaneGroup {
+	glm::aligned_vec4 x;
+	glm::aligned_vec4 y;
+	glm::aligned_vec4 z;
+	glm::aligned_vec4 w;
+	glm::aligned_vec4 absX;
+	glm::aligned_vec4 absY;
+	glm::aligned_vec4 absZ;
+};
+
+// Six planes, the last two are repeated to fill the second group.
+using Frustum = std::array<PlaneGroup, 2>;
+
+enum class Containment
+{
+	Outside,
+	Intersecting,
+	Inside,
+};
+
+Frustum makeFrustum(const QMatrix4x4 & clip)
+{
+	// Planes are sums and differences of the w row with the other rows.
+	const auto m = glm::make_mat4(clip.constData());
+	const auto row = [&](const int i) { return glm::vec4{m[0][i], m[1][i], m[2][i], m[3][i]}; };
+	const std::array<glm::vec4, 8> planes{
+		row(3) + row(0), row(3) - row(0), row(3) + row(1), row(3) - row(1),
+		row(3) + row(2), row(3) - row(2), row(3) + row(2), row(3) - row(2),
+	};
+
+	Frustum frustum;
+	for (size_t group = 0; group < frustum.size(); ++group)
+	{
+		const auto * p = &planes[group * 4];
+		auto & g = frustum[group];
+		g.x = {p[0].x, p[1].x, p[2].x, p[3].x};
+		g.y = {p[0].y, p[1].y, p[2].y, p[3].y};
+		g.z = {p[0].z, p[1].z, p[2].z, p[3].z};
+		g.w = {p[0].w, p[1].w, p[2].w, p[3].w};
+		g.absX = glm::abs(g.x);
+		g.absY = glm::abs(g.y);
+		g.absZ = glm::abs(g.z);
+	}
+	return frustum;
+}
+
+glm::aligned_vec4 load(const std::array<float, 4> & value)
+{
+	return {value[0], value[1], value[2], value[3]};
+}
+
+Containment classify(const Frustum & frustum, const glm::aligned_vec4 & min, const glm::aligned_vec4 & max)
+{
+	const auto center = (max + min) * 0.5f;
+	const auto extent = (max - min) * 0.5f;
+	const glm::aligned_vec4 zero{0.0f};
+
+	auto inside = true;
+	for (const auto & planes: frustum)
+	{
+		// Signed center distances and box radii projected on four planes.
+		const auto distance = planes.x * center.x + planes.y * center.y + planes.z * center.z + planes.w;
+		const auto radius = planes.absX * extent.x + planes.absY * extent.y + planes.absZ * extent.z;
+		if (glm::any(glm::lessThan(distance + radius, zero)))
+		{
+			return Containment::Outside;
+		}
+		inside = inside && glm::all(glm::greaterThanEqual(distance - radius, zero));
+	}
+	return inside ? Containment::Inside : Containment::Intersecting;
+}
+
+}// namespace
+
+void SceneBvh::build(const Scene & scene)
+{
+	clear();
+
+	const auto count = static_cast<uint32_t>(scene.nodes.size());
+	localBounds_.resize(count);
+	boxes_.resize(count);
+	leaves_.resize(count);
+	for (uint32_t i = 0; i < count; ++i)
+	{
+		const auto & node = scene.nodes[i];
+		localBounds_[i] = scene.meshes[node.mesh].bounds;
+		if (!localBounds_[i].valid)
+		{
+			// Nodes without bounds are kept as points.
+			localBounds_[i].extend(QVector3D{});
+		}
+		setTransform(i, node.world);
+	}
+
+	order_.resize(count);
+	std::iota(order_.begin(), order_.end(), 0u);
+	if (count)
+	{
+		nodes_.reserve(2 * (count / g_leafSize + 1));
+		buildNode(0, count, -1);
+	}
+	dirty_ = false;
+}
+
+void SceneBvh::clear()
+{
+	localBounds_.clear();
+	boxes_.clear();
+	leaves_.clear();
+	nodes_.clear();
+	order_.clear();
+	dirty_ = false;
+}
+
+void SceneBvh::setTransform(const size_t node, const QMatrix4x4 & world)
+{
+	const auto bounds = localBounds_[node].transformed(world);
+	auto & box = boxes_[node];
+	box.min = {bounds.min.x(), bounds.min.y(), bounds.min.z(), 0.0f};
+	box.max = {bounds.max.x(), bounds.max.y(), bounds.max.z(), 0.0f};
+
+	// Marks the path to the root, stops at an already dirty part of it.
+	if (nodes_.empty())
+	{
+		return;
+	}
+	for (auto index = static_cast<int32_t>(leaves_[node]); index >= 0 && !nodes_[index].dirty; index = nodes_[index].parent)
+	{
+		nodes_[index].dirty = true;
+	}
+	dirty_ = true;
+}
+
+void SceneBvh::refit()
+{
+	if (!dirty_)
+	{
+		return;
+	}
+	// Children are stored after their parents.
+	for (auto i = nodes_.size(); i-- > 0;)
+	{
+		auto & node = nodes_[i];
+		if (node.dirty)
+		{
+			fit(node);
+			node.dirty = false;
+		}
+	}
+	dirty_ = false;
+}
+
+void SceneBvh::cull(const QMatrix4x4 & clip, std::vector<uint32_t> & visible)
+{
+	visible.clear();
+	if (nodes_.empty())
+	{
+		return;
+	}
+	refit();
+
+	const auto frustum = makeFrustum(clip);
+	stack_.assign(1, 0);
+	while (!stack_.empty())
+	{
+		const auto & node = nodes_[stack_.back()];
+		const auto index = stack_.back();
+		stack_.pop_back();
+
+		const auto containment = classify(frustum, load(node.box.min), load(node.box.max));
+		if (containment == Containment::Outside)
+		{
+			continue;
+		}
+		if (containment == Containment::Inside)
+		{
+			// Whole subtree is visible, items are stored contiguously.
+			visible.insert(visible.end(), order_.begin() + node.first, order_.begin() + node.first + node.count);
+			continue;
+		}
+		if (node.right)
+		{
+			stack_.push_back(node.right);
+			stack_.push_back(index + 1);
+			continue;
+		}
+		for (auto i = node.first; i < node.first + node.count; ++i)
+		{
+			const auto & box = boxes_[order_[i]];
+			if (classify(frustum, load(box.min), load(box.max)) != Containment::Outside)
+			{
+				visible.push_back(order_[i]);
+			}
+		}
+	}
+}
+
+Bounds SceneBvh::bounds(const size_t node) const
+{
+	const auto & box = boxes_[node];
+	Bounds result;
+	result.extend(QVector3D{box.min[0], box.min[1], box.min[2]});
+	result.extend(QVector3D{box.max[0], box.max[1], box.max[2]});
+	return result;
+}
+
+size_t SceneBvh::size() const noexcept
+{
+	return boxes_.size();
+}
+
+uint32_t SceneBvh::buildNode(const uint32_t first, const uint32_t count, const int32_t parent)
+{
+	const auto index = static_cast<uint32_t>(nodes_.size());
+	nodes_.push_back({{}, first, count, 0, parent, false});
+	fit(nodes_[index]);
+
+	if (count <= g_leafSize)
+	{
+		for (auto i = first; i < first + count; ++i)
+		{
+			leaves_[order_[i]] = index;
+		}
+		return index;
+	}
+
+	// Median split along the longest axis of box centers.
+	glm::vec3 lower{std::numeric_limits<float>::max()};
+	glm::vec3 upper{std::numeric_limits<float>::lowest()};
+	const auto center = [&](const uint32_t item) {
+		const auto & box = boxes_[item];
+		return (glm::make_vec3(box.min.data()) + glm::make_vec3(box.max.data())) * 0.5f;
+	};
+	for (auto i = first; i < first + count; ++i)
+	{
+		lower = glm::min(lower, center(order_[i]));
+		upper = glm::max(upper, center(order_[i]));
+	}
+	const auto extent = upper - lower;
+	const auto axis = extent.x >= extent.y && extent.x >= extent.z ? 0 : (extent.y >= extent.z ? 1 : 2);
+
+	const auto begin = order_.begin() + first;
+	const auto half = count / 2;
+	std::nth_element(begin, begin + half, begin + count,
+					 [&](const uint32_t lhs, const uint32_t rhs) { return center(lhs)[axis] < center(rhs)[axis]; });
+
+	buildNode(first, half, static_cast<int32_t>(index));
+	const auto right = buildNode(first + half, count - half, static_cast<int32_t>(index));
+	nodes_[index].right = right;
+	return index;
+}
+
+void SceneBvh::fit(TreeNode & node) const
+{
+	glm::aligned_vec4 min{std::numeric_limits<float>::max()};
+	glm::aligned_vec4 max{std::numeric_limits<float>::lowest()};
+	const auto merge = [&](const Box & box) {
+		min = glm::min(min, load(box.min));
+		max = glm::max(max, load(box.max));
+	};
+	if (node.right)
+	{
+		const auto index = static_cast<size_t>(&node - nodes_.data());
+		merge(nodes_[index + 1].box);
+		merge(nodes_[node.right].box);
+	}
+	else
+	{
+		for (auto i = node.first; i < node.first + node.count; ++i)
+		{
+			merge(boxes_[order_[i]]);
+		}
+	}
+	node.box.min = {min.x, min.y, min.z, 0.0f};
+	node.box.max = {max.x, max.y, max.z, 0.0f};
+}
+
+}// namespace fgl
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <QMatrix4x4>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace fgl
+{
+
+// Bounding volume hierarchy over world space bounds of scene nodes, used to
+// cull nodes outside of the view frustum. Moved nodes are refitted without
+// rebuilding the tree.
+class SceneBvh final
+{
+public:
+	// Nodes are indexed as in Scene::nodes.
+	void build(const Scene & scene);
+	void clear();
+
+	// Updates bounds of a node whose world matrix changed and marks the path
+	// to the root through parent links. refit() then fits marked boxes only,
+	// so moving a few nodes costs their paths rather than a rebuild. Call it
+	// for every moved node, cull() refits before testing.
+	void setTransform(size_t node, const QMatrix4x4 & world);
+	void refit();
+
+	// Replaces visible with nodes intersecting the frustum of clip, which
+	// maps scene world space to clip space. Refits the tree if needed.
+	void cull(const QMatrix4x4 & clip, std::vector<uint32_t> & visible);
+
+	// World space bounds of a node.
+	[[nodiscard]] Bounds bounds(size_t node) const;
+	[[nodiscard]] size_t size() const noexcept;
+
+private:
+	// Padded to four floats, loaded into SIMD registers as is.
+	struct Box {
+		alignas(16) std::array<float, 4> min{};
+		alignas(16) std::array<float, 4> max{};
+	};
+
+	struct TreeNode {
+		Box box;
+		// Subtree items are order_[first, first + count).
+		uint32_t first = 0;
+		uint32_t count = 0;
+		// Left child follows its parent, zero marks leaves.
+		uint32_t right = 0;
+		int32_t parent = -1;
+		bool dirty = false;
+	};
+
+	uint32_t buildNode(uint32_t first, uint32_t count, int32_t parent);
+	void fit(TreeNode & node) const;
+
+private:
+	// Indexed by scene node.
+	std::vector<Bounds> localBounds_;
+	std::vector<Box> boxes_;
+	std::vector<uint32_t> leaves_;
+
+	std::vector<TreeNode> nodes_;
+	std::vector<uint32_t> order_;
+	std::vector<uint32_t> stack_;
+	bool dirty_ = false;
+};
+
+}// namespace fgl
@@ -0,0 +1,163 @@
+#include "StreamBuffer.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Partitions start at offsets suitable for any binding.
+constexpr size_t g_partitionAlignment = 256;
+constexpr GLuint64 g_waitTimeoutNs = 1000000;
+
+size_t alignedTo(const size_t size, const size_t alignment)
+{
+	return (size + alignment - 1) / alignment * alignment;
+}
+
+}// namespace
+
+StreamBuffer::StreamBuffer(const size_t frames)
+	: frames_{std::max(frames, size_t{1})}
+	, fences_(frames_, nullptr)
+{
+}
+
+void StreamBuffer::initialize(const size_t partitionSize)
+{
+	initializeOpenGLFunctions();
+	glGenBuffers(1, &buffer_);
+	if (partitionSize)
+	{
+		partitionSize_ = alignedTo(partitionSize, g_partitionAlignment);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(partitionSize_ * frames_), nullptr, GL_STREAM_DRAW);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+}
+
+void StreamBuffer::release()
+{
+	for (auto & fence: fences_)
+	{
+		if (fence)
+		{
+			glDeleteSync(fence);
+			fence = nullptr;
+		}
+	}
+	if (buffer_)
+	{
+		glDeleteBuffers(1, &buffer_);
+		buffer_ = 0;
+	}
+	partitionSize_ = 0;
+	mapped_ = nullptr;
+}
+
+void StreamBuffer::begin(const size_t size)
+{
+	partition_ = (partition_ + 1) % frames_;
+	stalls_ = 0;
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+	if (size > partitionSize_)
+	{
+		// New storage is only safe to write once no partition is read.
+		for (auto & fence: fences_)
+		{
+			wait(fence);
+		}
+		partitionSize_ = alignedTo(std::max(size, partitionSize_ * 2), g_partitionAlignment);
+		glBufferData(GL_COPY_WRITE_BUFFER, static_cast<GLsizeiptr>(partitionSize_ * frames_), nullptr, GL_STREAM_DRAW);
+	}
+	wait(fences_[partition_]);
+
+	mappedOffset_ = partition_ * partitionSize_;
+	mappedSize_ = size;
+	used_ = 0;
+	mapped_ = nullptr;
+	if (size)
+	{
+		constexpr GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_FLUSH_EXPLICIT_BIT;
+		mapped_ = static_cast<std::byte *>(
+			glMapBufferRange(GL_COPY_WRITE_BUFFER, static_cast<GLintptr>(mappedOffset_), static_cast<GLsizeiptr>(size), access));
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+StreamBuffer::Allocation StreamBuffer::allocate(const size_t size, const size_t alignment)
+{
+	const auto offset = alignedTo(mappedOffset_ + used_, alignment) - mappedOffset_;
+	if (!mapped_ || offset + size > mappedSize_)
+	{
+		return {};
+	}
+	used_ = offset + size;
+	return {mapped_ + offset, mappedOffset_ + offset};
+}
+
+void StreamBuffer::finish()
+{
+	if (!mapped_)
+	{
+		return;
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, buffer_);
+	glFlushMappedBufferRange(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(used_));
+	if (!glUnmapBuffer(GL_COPY_WRITE_BUFFER))
+	{
+		qWarning() << "Stream buffer contents were lost";
+	}
+	glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	mapped_ = nullptr;
+}
+
+void StreamBuffer::fence()
+{
+	auto & fence = fences_[partition_];
+	if (fence)
+	{
+		glDeleteSync(fence);
+	}
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+GLuint StreamBuffer::buffer() const noexcept
+{
+	return buffer_;
+}
+
+size_t StreamBuffer::used() const noexcept
+{
+	return used_;
+}
+
+size_t StreamBuffer::stalls() const noexcept
+{
+	return stalls_;
+}
+
+void StreamBuffer::wait(GLsync & fence)
+{
+	if (!fence)
+	{
+		return;
+	}
+	auto result = glClientWaitSync(fence, 0, 0);
+	if (result == GL_TIMEOUT_EXPIRED)
+	{
+		++stalls_;
+		while (result == GL_TIMEOUT_EXPIRED)
+		{
+			result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, g_waitTimeoutNs);
+		}
+	}
+	glDeleteSync(fence);
+	fence = nullptr;
+}
+
+}// namespace fgl
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QOpenGLExtraFunctions>
+
+#include <cstddef>
+#include <vector>
+
+namespace fgl
+{
+
+// Buffer for data rewritten every frame: UI vertices, per frame constants
+// and the like. Storage is split into one partition per frame in flight,
+// each frame maps the next partition unsynchronized and writes into it
+// directly. A fence after the draws of a frame guards its partition, so
+// the CPU only waits when the GPU is a whole ring of frames behind and
+// never on implicit driver synchronization. The buffer is mapped through
+// the copy write binding, so it can be used with any target.
+class StreamBuffer final : protected QOpenGLExtraFunctions
+{
+public:
+	struct Allocation {
+		// Null when the allocation does not fit into the mapped range.
+		std::byte * data = nullptr;
+		// Offset in the buffer.
+		size_t offset = 0;
+	};
+
+	explicit StreamBuffer(size_t frames = 3);
+
+	StreamBuffer(const StreamBuffer &) = delete;
+	StreamBuffer(StreamBuffer &&) = delete;
+	StreamBuffer & operator=(const StreamBuffer &) = delete;
+	StreamBuffer & operator=(StreamBuffer &&) = delete;
+
+	// Both require a bound context.
+	void initialize(size_t partitionSize = 0);
+	void release();
+
+	// Waits until the GPU is done with the next partition and maps size
+	// bytes of it. Partitions grow to fit, which waits for all of them.
+	// Requires a bound context, as all calls below.
+	void begin(size_t size);
+	// Sub-allocates from the mapped range, offsets are aligned in the buffer.
+	[[nodiscard]] Allocation allocate(size_t size, size_t alignment = 16);
+	// Flushes allocated bytes and unmaps them, draws may read them after.
+	void finish();
+	// Marks the end of draws reading the partition, once per frame.
+	void fence();
+
+	[[nodiscard]] GLuint buffer() const noexcept;
+	// Bytes written since the last begin().
+	[[nodiscard]] size_t used() const noexcept;
+	// Waits for the GPU to release partitions in the last begin(), so it is
+	// a per-frame count.
+	[[nodiscard]] size_t stalls() const noexcept;
+
+private:
+	void wait(GLsync & fence);
+
+private:
+	size_t frames_;
+	GLuint buffer_ = 0;
+	size_t partitionSize_ = 0;
+	size_t partition_ = 0;
+	std::vector<GLsync> fences_;
+
+	std::byte * mapped_ = nullptr;
+	size_t mappedOffset_ = 0;
+	size_t mappedSize_ = 0;
+	size_t used_ = 0;
+	size_t stalls_ = 0;
+};
+
+}// namespace fgl
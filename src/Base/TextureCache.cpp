@@ -0,0 +1,112 @@
+#include "TextureCache.hpp"
+
+#include "Ktx2.hpp"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Bumped when encoded blocks change.
+constexpr char g_version = 1;
+constexpr auto g_extension = ".ktx2";
+constexpr auto g_tiledExtension = ".fgltiles";
+
+}// namespace
+
+TextureCache::TextureCache(QString directory)
+	: directory_{std::move(directory)}
+{
+}
+
+QString TextureCache::defaultDirectory()
+{
+	return QDir(QStandardPaths::writableLocation(QStandardPaths::CacheLocation)).filePath("textures");
+}
+
+QByteArray TextureCache::hash(const gsl::span<const std::byte> bytes)
+{
+	QCryptographicHash hash(QCryptographicHash::Sha1);
+	hash.addData(&g_version, 1);
+	hash.addData(reinterpret_cast<const char *>(bytes.data()), static_cast<int>(bytes.size()));
+	return hash.result();
+}
+
+bool TextureCache::load(const QByteArray & key, CompressedTexture & texture) const
+{
+	QFile file(entryPath(key, g_extension));
+	if (!file.exists())
+	{
+		return false;
+	}
+	const auto size = file.size();
+	const auto * mapped = file.open(QIODevice::ReadOnly) ? file.map(0, size) : nullptr;
+	if (!mapped)
+	{
+		qWarning() << "Failed to map" << file.fileName();
+		return false;
+	}
+	if (!readKtx2({reinterpret_cast<const std::byte *>(mapped), static_cast<size_t>(size)}, texture))
+	{
+		qWarning() << file.fileName() << "is corrupted.";
+		return false;
+	}
+	return true;
+}
+
+bool TextureCache::store(const QByteArray & key, const CompressedTexture & texture) const
+{
+	const auto blob = writeKtx2(texture);
+	if (blob.isEmpty())
+	{
+		return false;
+	}
+	// Written atomically, so other threads never see a partial entry.
+	if (!QDir().mkpath(directory_))
+	{
+		qWarning() << "Failed to create" << directory_;
+		return false;
+	}
+	QSaveFile file(entryPath(key, g_extension));
+	if (!file.open(QIODevice::WriteOnly) || file.write(blob) != blob.size() || !file.commit())
+	{
+		qWarning() << "Failed to cache texture:" << file.errorString();
+		return false;
+	}
+	return true;
+}
+
+TiledImage TextureCache::loadTiled(const QByteArray & key) const
+{
+	return readTiledImage(entryPath(key, g_tiledExtension));
+}
+
+TiledImage TextureCache::storeTiled(const QByteArray & key, const tinygltf::Image & image) const
+{
+	if (!QDir().mkpath(directory_))
+	{
+		qWarning() << "Failed to create" << directory_;
+		return {};
+	}
+	auto tiled = writeTiledImage(image, entryPath(key, g_tiledExtension));
+	if (tiled.path.isEmpty())
+	{
+		qWarning() << "Failed to cache tiles of image";
+	}
+	return tiled;
+}
+
+QString TextureCache::entryPath(const QByteArray & key, const char * extension) const
+{
+	return QDir(directory_).filePath(QString::fromLatin1(key.toHex()) + extension);
+}
+
+}// namespace fgl
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "TextureCompressor.hpp"
+#include "TiledImage.hpp"
+
+#include <QByteArray>
+#include <QString>
+
+#include <gsl/span>
+
+namespace fgl
+{
+
+// On-disk cache of compressed textures, one KTX2 file per image named after
+// the SHA-1 of its encoded bytes and the encoder version. Tiles of images
+// streamed by VirtualTexture are kept next to them. Unlike MeshCache
+// it is used from image decoding threads, so it keeps no state and reports
+// failures with qWarning(), misses are not failures.
+class TextureCache final
+{
+public:
+	explicit TextureCache(QString directory = defaultDirectory());
+
+	[[nodiscard]] static QString defaultDirectory();
+	[[nodiscard]] static QByteArray hash(gsl::span<const std::byte> bytes);
+
+	[[nodiscard]] bool load(const QByteArray & key, CompressedTexture & texture) const;
+	bool store(const QByteArray & key, const CompressedTexture & texture) const;
+
+	// Both return an empty image on miss or failure.
+	[[nodiscard]] TiledImage loadTiled(const QByteArray & key) const;
+	[[nodiscard]] TiledImage storeTiled(const QByteArray & key, const tinygltf::Image & image) const;
+
+private:
+	[[nodiscard]] QString entryPath(const QByteArray & key, const char * extension) const;
+
+private:
+	QString directory_;
+};
+
+}// namespace fgl
@@ -0,0 +1,293 @@
+#include "TextureCompressor.hpp"
+
+#include <QOpenGLContext>
+
+#include <glm/glm.hpp>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr int g_blockDimension = 4;
+constexpr size_t g_blockTexels = 16;
+constexpr int g_axisIterations = 8;
+
+struct Pixels {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> rgba;
+};
+
+// 2x2 box filter, odd edges repeat their last texel.
+Pixels downsample(const Pixels & source)
+{
+	Pixels result{std::max(source.width / 2, 1), std::max(source.height / 2, 1), {}};
+	result.rgba.resize(static_cast<size_t>(result.width) * static_cast<size_t>(result.height) * 4);
+	for (int y = 0; y < result.height; ++y)
+	{
+		for (int x = 0; x < result.width; ++x)
+		{
+			std::array<int, 4> sum{};
+			for (int dy = 0; dy < 2; ++dy)
+			{
+				for (int dx = 0; dx < 2; ++dx)
+				{
+					const auto sx = static_cast<size_t>(std::min(x * 2 + dx, source.width - 1));
+					const auto sy = static_cast<size_t>(std::min(y * 2 + dy, source.height - 1));
+					const auto * texel = source.rgba.data() + (sy * static_cast<size_t>(source.width) + sx) * 4;
+					for (size_t c = 0; c < 4; ++c)
+					{
+						sum[c] += texel[c];
+					}
+				}
+			}
+			auto * target = result.rgba.data() + (static_cast<size_t>(y) * static_cast<size_t>(result.width) + static_cast<size_t>(x)) * 4;
+			for (size_t c = 0; c < 4; ++c)
+			{
+				target[c] = static_cast<unsigned char>((sum[c] + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+uint16_t toRgb565(const glm::vec3 & color)
+{
+	const auto channel = [](const float value, const float max) {
+		return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 255.0f) * max / 255.0f));
+	};
+	return static_cast<uint16_t>((channel(color.r, 31.0f) << 11) | (channel(color.g, 63.0f) << 5) | channel(color.b, 31.0f));
+}
+
+// Low bits are filled with the high ones, as decoders do.
+glm::vec3 fromRgb565(const uint16_t color)
+{
+	const auto r = (color >> 11) & 31;
+	const auto g = (color >> 5) & 63;
+	const auto b = color & 31;
+	return {static_cast<float>((r << 3) | (r >> 2)), static_cast<float>((g << 2) | (g >> 4)), static_cast<float>((b << 3) | (b >> 2))};
+}
+
+void storeLittleEndian(std::byte * target, uint64_t value, const size_t bytes)
+{
+	for (size_t i = 0; i < bytes; ++i, value >>= 8)
+	{
+		target[i] = static_cast<std::byte>(value & 0xFF);
+	}
+}
+
+// Endpoints are the extremes of block colors projected on their principal
+// axis, inset by 1/16 of the range as they are rarely hit exactly.
+void encodeColorBlock(const std::array<glm::vec3, g_blockTexels> & colors, std::byte * target)
+{
+	glm::vec3 mean{0.0f};
+	for (const auto & color: colors)
+	{
+		mean += color;
+	}
+	mean /= static_cast<float>(g_blockTexels);
+
+	glm::mat3 covariance{0.0f};
+	for (const auto & color: colors)
+	{
+		const auto d = color - mean;
+		covariance += glm::outerProduct(d, d);
+	}
+	glm::vec3 axis{1.0f};
+	for (int i = 0; i < g_axisIterations; ++i)
+	{
+		const auto next = covariance * axis;
+		const auto length = glm::length(next);
+		if (length < 1e-6f)
+		{
+			break;
+		}
+		axis = next / length;
+	}
+	axis = glm::normalize(axis);
+
+	auto low = std::numeric_limits<float>::max();
+	auto high = std::numeric_limits<float>::lowest();
+	for (const auto & color: colors)
+	{
+		const auto t = glm::dot(color - mean, axis);
+		low = std::min(low, t);
+		high = std::max(high, t);
+	}
+	const auto inset = (high - low) / 16.0f;
+	auto color0 = toRgb565(mean + axis * (high - inset));
+	auto color1 = toRgb565(mean + axis * (low + inset));
+	// Four color mode needs the first endpoint to be greater.
+	if (color0 < color1)
+	{
+		std::swap(color0, color1);
+	}
+
+	uint32_t indices = 0;
+	if (color0 != color1)
+	{
+		const auto p0 = fromRgb565(color0);
+		const auto p1 = fromRgb565(color1);
+		const std::array<glm::vec3, 4> palette{p0, p1, (p0 * 2.0f + p1) / 3.0f, (p0 + p1 * 2.0f) / 3.0f};
+		for (size_t i = 0; i < g_blockTexels; ++i)
+		{
+			uint32_t best = 0;
+			auto bestDistance = std::numeric_limits<float>::max();
+			for (uint32_t j = 0; j < palette.size(); ++j)
+			{
+				const auto d = colors[i] - palette[j];
+				const auto distance = glm::dot(d, d);
+				if (distance < bestDistance)
+				{
+					best = j;
+					bestDistance = distance;
+				}
+			}
+			indices |= best << (i * 2);
+		}
+	}
+	storeLittleEndian(target, color0, 2);
+	storeLittleEndian(target + 2, color1, 2);
+	storeLittleEndian(target + 4, indices, 4);
+}
+
+// Eight value mode between the extremes.
+void encodeAlphaBlock(const std::array<int, g_blockTexels> & alphas, std::byte * target)
+{
+	const auto [low, high] = std::minmax_element(alphas.begin(), alphas.end());
+	const auto alpha0 = *high;
+	const auto alpha1 = *low;
+	uint64_t indices = 0;
+	if (alpha0 != alpha1)
+	{
+		std::array<int, 8> palette{alpha0, alpha1};
+		for (int j = 1; j < 7; ++j)
+		{
+			palette[static_cast<size_t>(j + 1)] = ((7 - j) * alpha0 + j * alpha1 + 3) / 7;
+		}
+		for (size_t i = 0; i < g_blockTexels; ++i)
+		{
+			uint64_t best = 0;
+			for (uint64_t j = 1; j < palette.size(); ++j)
+			{
+				if (std::abs(alphas[i] - palette[j]) < std::abs(alphas[i] - palette[best]))
+				{
+					best = j;
+				}
+			}
+			indices |= best << (i * 3);
+		}
+	}
+	storeLittleEndian(target, static_cast<uint64_t>(alpha0), 1);
+	storeLittleEndian(target + 1, static_cast<uint64_t>(alpha1), 1);
+	storeLittleEndian(target + 2, indices, 6);
+}
+
+CompressedTexture::Level encodeLevel(const Pixels & pixels, const GLenum format)
+{
+	CompressedTexture::Level level{pixels.width, pixels.height, {}};
+	level.data.resize(CompressedTexture::levelSize(format, pixels.width, pixels.height));
+	const auto alpha = format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	auto * target = level.data.data();
+	for (int by = 0; by < pixels.height; by += g_blockDimension)
+	{
+		for (int bx = 0; bx < pixels.width; bx += g_blockDimension)
+		{
+			// Blocks over the edges repeat the last texels.
+			std::array<glm::vec3, g_blockTexels> colors{};
+			std::array<int, g_blockTexels> alphas{};
+			for (int y = 0; y < g_blockDimension; ++y)
+			{
+				for (int x = 0; x < g_blockDimension; ++x)
+				{
+					const auto sx = static_cast<size_t>(std::min(bx + x, pixels.width - 1));
+					const auto sy = static_cast<size_t>(std::min(by + y, pixels.height - 1));
+					const auto * texel = pixels.rgba.data() + (sy * static_cast<size_t>(pixels.width) + sx) * 4;
+					const auto i = static_cast<size_t>(y * g_blockDimension + x);
+					colors[i] = {texel[0], texel[1], texel[2]};
+					alphas[i] = texel[3];
+				}
+			}
+			if (alpha)
+			{
+				encodeAlphaBlock(alphas, target);
+				target += 8;
+			}
+			encodeColorBlock(colors, target);
+			target += 8;
+		}
+	}
+	return level;
+}
+
+}// namespace
+
+bool CompressedTexture::isEmpty() const noexcept
+{
+	return !format || levels.empty();
+}
+
+size_t CompressedTexture::blockSize(const GLenum format)
+{
+	switch (format)
+	{
+		case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+			return 8;
+		case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+			return 16;
+		default:
+			return 0;
+	}
+}
+
+size_t CompressedTexture::levelSize(const GLenum format, const int width, const int height)
+{
+	const auto blocks = [](const int size) { return static_cast<size_t>((std::max(size, 1) + g_blockDimension - 1) / g_blockDimension); };
+	return blocks(width) * blocks(height) * blockSize(format);
+}
+
+CompressedTexture compressTexture(const tinygltf::Image & image)
+{
+	CompressedTexture result;
+	const auto texels = static_cast<size_t>(std::max(image.width, 0)) * static_cast<size_t>(std::max(image.height, 0));
+	if (image.bits != 8 || image.component != 4 || !texels || image.image.size() < texels * 4)
+	{
+		return result;
+	}
+
+	Pixels level{image.width, image.height, {image.image.begin(), image.image.begin() + static_cast<std::ptrdiff_t>(texels * 4)}};
+	auto opaque = true;
+	for (size_t i = 3; i < level.rgba.size() && opaque; i += 4)
+	{
+		opaque = level.rgba[i] == 255;
+	}
+	result.format = opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	while (true)
+	{
+		result.levels.push_back(encodeLevel(level, result.format));
+		if (level.width == 1 && level.height == 1)
+		{
+			break;
+		}
+		level = downsample(level);
+	}
+	return result;
+}
+
+bool isTextureCompressionSupported()
+{
+	const auto * context = QOpenGLContext::currentContext();
+	return context && context->hasExtension("GL_EXT_texture_compression_s3tc");
+}
+
+}// namespace fgl
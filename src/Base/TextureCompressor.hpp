@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QOpenGLTexture>
+
+#include <cstddef>
+#include <vector>
+
+namespace tinygltf
+{
+struct Image;
+}// namespace tinygltf
+
+namespace fgl
+{
+
+// Block compressed texture with its mip chain, from the base level.
+struct CompressedTexture {
+	struct Level {
+		int width = 0;
+		int height = 0;
+		std::vector<std::byte> data;
+	};
+
+	// GL_COMPRESSED_RGB_S3TC_DXT1_EXT or GL_COMPRESSED_RGBA_S3TC_DXT5_EXT.
+	GLenum format = 0;
+	std::vector<Level> levels;
+
+	[[nodiscard]] bool isEmpty() const noexcept;
+	// Bytes of 4x4 blocks of format, zero for unknown ones.
+	[[nodiscard]] static size_t blockSize(GLenum format);
+	[[nodiscard]] static size_t levelSize(GLenum format, int width, int height);
+};
+
+// Box filters a full mip chain of RGBA8 image and encodes every level into
+// BC1, or BC3 when any pixel is translucent. Endpoints are picked along the
+// principal axis of block colors. Returns empty texture for other pixel
+// formats.
+[[nodiscard]] CompressedTexture compressTexture(const tinygltf::Image & image);
+
+// Block compression is optional in GL, it comes with the S3TC extension.
+// Requires a bound context.
+[[nodiscard]] bool isTextureCompressionSupported();
+
+}// namespace fgl
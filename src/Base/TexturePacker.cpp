@@ -0,0 +1,218 @@
+#include "TexturePacker.hpp"
+
+#include "TextureUploader.hpp"
+
+#include <QDebug>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+#include <iterator>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Guaranteed minimum of GL_MAX_ARRAY_TEXTURE_LAYERS.
+constexpr size_t g_maxLayers = 256;
+
+}// namespace
+
+TexturePacker::TexturePacker(const int maxPackedSize)
+	: maxPackedSize_{maxPackedSize}
+{
+}
+
+void TexturePacker::setUploader(TextureUploader * const uploader) noexcept
+{
+	uploader_ = uploader;
+}
+
+void TexturePacker::add(const size_t image, std::unique_ptr<tinygltf::Image> pixels)
+{
+	GLenum format = 0;
+	if (pixels->component == 4 && pixels->bits == 8)
+	{
+		format = GL_RGBA8;
+	}
+	else if (pixels->component == 4 && pixels->bits == 16)
+	{
+		format = GL_RGBA16;
+	}
+	const auto size = static_cast<size_t>(pixels->width) * static_cast<size_t>(pixels->height) * 4 * static_cast<size_t>(pixels->bits / 8);
+	if (!format || pixels->width <= 0 || pixels->height <= 0 || pixels->image.size() < size)
+	{
+		qWarning() << "Unsupported pixel format of image" << image;
+		return;
+	}
+	const Key key{format, pixels->width, pixels->height, 1};
+	add(key, {image, std::move(pixels), {}});
+}
+
+void TexturePacker::add(const size_t image, CompressedTexture compressed)
+{
+	if (compressed.isEmpty())
+	{
+		return;
+	}
+	const auto & base = compressed.levels.front();
+	const Key key{compressed.format, base.width, base.height, compressed.levels.size()};
+	add(key, {image, nullptr, std::move(compressed)});
+}
+
+auto TexturePacker::upload(const bool all) -> std::vector<PackedTexture>
+{
+	std::vector<PackedTexture> textures;
+	for (auto & [key, entry]: large_)
+	{
+		uploadArray(key, {&entry, 1}, textures);
+	}
+	large_.clear();
+	if (all)
+	{
+		for (auto & [key, entries]: small_)
+		{
+			for (size_t i = 0; i < entries.size(); i += g_maxLayers)
+			{
+				uploadArray(key, gsl::span<Entry>{entries}.subspan(i, std::min(g_maxLayers, entries.size() - i)), textures);
+			}
+		}
+		small_.clear();
+	}
+	return textures;
+}
+
+void TexturePacker::clear()
+{
+	small_.clear();
+	large_.clear();
+}
+
+bool TexturePacker::isEmpty() const noexcept
+{
+	return small_.empty() && large_.empty();
+}
+
+void TexturePacker::add(const Key & key, Entry entry)
+{
+	const auto & [format, width, height, levels] = key;
+	if (width <= maxPackedSize_ && height <= maxPackedSize_)
+	{
+		small_[key].push_back(std::move(entry));
+	}
+	else
+	{
+		large_.emplace_back(key, std::move(entry));
+	}
+}
+
+void TexturePacker::uploadArray(const Key & key, const gsl::span<Entry> entries, std::vector<PackedTexture> & textures)
+{
+	const auto & [format, width, height, levels] = key;
+	const auto layers = static_cast<GLsizei>(entries.size());
+	PackedTexture result;
+	result.texture = std::make_unique<QOpenGLTexture>(QOpenGLTexture::Target2DArray);
+	result.texture->create();
+	result.texture->bind();
+	auto * gl = QOpenGLContext::currentContext()->extraFunctions();
+
+	// Layers of a level are consecutive, single images are uploaded in place.
+	// Streamed storage is left undefined until the uploader fills it.
+	std::vector<std::byte> data;
+	const auto gather = [&](const auto & bytes) -> const void * {
+		if (uploader_)
+		{
+			return nullptr;
+		}
+		if (entries.size() == 1)
+		{
+			return bytes(entries.front()).data();
+		}
+		data.clear();
+		for (auto & entry: entries)
+		{
+			const auto & source = bytes(entry);
+			const auto * begin = reinterpret_cast<const std::byte *>(source.data());
+			data.insert(data.end(), begin, begin + source.size());
+		}
+		return data.data();
+	};
+
+	if (entries.front().pixels)
+	{
+		const auto type = format == GL_RGBA16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+		const auto size = static_cast<size_t>(width) * static_cast<size_t>(height) * (format == GL_RGBA16 ? 8 : 4);
+		// Decoded pixels may carry padding past the image.
+		for (auto & entry: entries)
+		{
+			entry.pixels->image.resize(size);
+		}
+		const auto * pixels = gather([](const Entry & entry) -> const auto & { return entry.pixels->image; });
+		gl->glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, static_cast<GLint>(format), width, height, layers, 0, GL_RGBA, type, pixels);
+		if (!uploader_)
+		{
+			gl->glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+	}
+	else
+	{
+		for (size_t level = 0; level < levels; ++level)
+		{
+			const auto & first = entries.front().compressed.levels[level];
+			const auto * blocks = gather([level](const Entry & entry) -> const auto & { return entry.compressed.levels[level].data; });
+			gl->glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), format, first.width, first.height, layers, 0,
+									   static_cast<GLsizei>(first.data.size() * entries.size()), blocks);
+		}
+		gl->glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels - 1));
+	}
+	result.texture->release();
+	result.texture->setMinMagFilters(QOpenGLTexture::LinearMipMapLinear, QOpenGLTexture::Linear);
+	result.texture->setWrapMode(QOpenGLTexture::WrapMode::Repeat);
+
+	for (size_t i = 0; i < entries.size(); ++i)
+	{
+		result.layers.emplace_back(entries[i].image, static_cast<int>(i));
+	}
+	if (uploader_)
+	{
+		streamArray(key, entries, std::move(result));
+	}
+	else
+	{
+		textures.push_back(std::move(result));
+	}
+}
+
+void TexturePacker::streamArray(const Key & key, const gsl::span<Entry> entries, PackedTexture texture)
+{
+	const auto & [format, width, height, levels] = key;
+	// Entries move with their heap data, so regions stay valid.
+	auto owner = std::make_shared<std::vector<Entry>>(std::make_move_iterator(entries.begin()), std::make_move_iterator(entries.end()));
+	std::vector<TextureUploader::Region> regions;
+	for (size_t i = 0; i < owner->size(); ++i)
+	{
+		const auto & entry = (*owner)[i];
+		const auto layer = static_cast<GLint>(i);
+		if (entry.pixels)
+		{
+			const auto & pixels = entry.pixels->image;
+			const auto type = format == GL_RGBA16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_BYTE;
+			regions.push_back({0, layer, width, height, GL_RGBA, static_cast<GLenum>(type),
+							   {reinterpret_cast<const std::byte *>(pixels.data()), pixels.size()}});
+			continue;
+		}
+		for (size_t level = 0; level < levels; ++level)
+		{
+			const auto & blocks = entry.compressed.levels[level];
+			regions.push_back({static_cast<GLint>(level), layer, blocks.width, blocks.height, format, 0, blocks.data});
+		}
+	}
+	const auto mipmaps = owner->front().pixels != nullptr;
+	uploader_->push(std::move(texture), std::move(regions), std::move(owner), mipmaps);
+}
+
+}// namespace fgl
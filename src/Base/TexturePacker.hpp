@@ -0,0 +1,81 @@
+#pragma once
+
+#include "TextureCompressor.hpp"
+
+#include <QOpenGLTexture>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace tinygltf
+{
+struct Image;
+}// namespace tinygltf
+
+namespace fgl
+{
+
+class TextureUploader;
+
+// Array texture and the image stored in each of its layers.
+struct PackedTexture {
+	std::unique_ptr<QOpenGLTexture> texture;
+	// Image index and layer.
+	std::vector<std::pair<size_t, int>> layers;
+};
+
+// Uploads images as 2D array textures. Images up to maxPackedSize of the
+// same size, format and mip count become layers of one array, so materials
+// using them draw without texture rebinds. Layers are not resized, so UVs
+// and wrapping stay as they are. Larger images get arrays of their own.
+class TexturePacker final
+{
+public:
+	explicit TexturePacker(int maxPackedSize = 256);
+
+	// With an uploader upload() only allocates textures and pushes their
+	// data to it, they are returned by TextureUploader::upload() instead.
+	void setUploader(TextureUploader * uploader) noexcept;
+
+	// RGBA8 and RGBA16 pixels get driver generated mips, other formats are
+	// dropped.
+	void add(size_t image, std::unique_ptr<tinygltf::Image> pixels);
+	void add(size_t image, CompressedTexture compressed);
+
+	// Uploads added images. Small ones are kept unless all is set, as later
+	// images may still share their arrays. Requires a bound context.
+	[[nodiscard]] std::vector<PackedTexture> upload(bool all);
+
+	void clear();
+	[[nodiscard]] bool isEmpty() const noexcept;
+
+private:
+	// Either pixels or compressed blocks are set.
+	struct Entry {
+		size_t image = 0;
+		std::unique_ptr<tinygltf::Image> pixels;
+		CompressedTexture compressed;
+	};
+
+	// Internal format, width, height and levels.
+	using Key = std::tuple<GLenum, int, int, size_t>;
+
+	void add(const Key & key, Entry entry);
+	// Adds array texture to textures, or pushes it to the uploader.
+	void uploadArray(const Key & key, gsl::span<Entry> entries, std::vector<PackedTexture> & textures);
+	void streamArray(const Key & key, gsl::span<Entry> entries, PackedTexture texture);
+
+private:
+	int maxPackedSize_ = 0;
+	TextureUploader * uploader_ = nullptr;
+	std::map<Key, std::vector<Entry>> small_;
+	std::vector<std::pair<Key, Entry>> large_;
+};
+
+}// namespace fgl
@@ -0,0 +1,212 @@
+#include "TextureUploader.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+// Rows of compressed formats are rows of 4x4 blocks.
+constexpr GLsizei g_blockDimension = 4;
+
+}// namespace
+
+TextureUploader::TextureUploader(const size_t budget, const size_t buffers)
+	: budget_{budget}
+	, buffers_(buffers)
+{
+}
+
+void TextureUploader::initialize()
+{
+	initializeOpenGLFunctions();
+	for (auto & buffer: buffers_)
+	{
+		glGenBuffers(1, &buffer.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(budget_), nullptr, GL_STREAM_DRAW);
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+void TextureUploader::release()
+{
+	clear();
+	// Does nothing when not initialized.
+	for (auto & buffer: buffers_)
+	{
+		if (!buffer.buffer)
+		{
+			continue;
+		}
+		glDeleteSync(buffer.fence);
+		glDeleteBuffers(1, &buffer.buffer);
+		buffer = {};
+	}
+}
+
+void TextureUploader::push(PackedTexture texture, std::vector<Region> regions, std::shared_ptr<const void> owner, const bool mipmaps)
+{
+	std::erase_if(regions, [](const Region & region) { return region.data.empty(); });
+	for (const auto & region: regions)
+	{
+		pendingBytes_ += region.data.size();
+	}
+	pending_.push_back({std::move(texture), std::move(regions), std::move(owner), mipmaps});
+}
+
+auto TextureUploader::upload() -> std::vector<PackedTexture>
+{
+	std::vector<PackedTexture> finished;
+	if (pending_.empty() || buffers_.empty())
+	{
+		return finished;
+	}
+
+	// Buffers are reused in order, the frame is skipped while the oldest
+	// one is still read.
+	auto & buffer = buffers_[nextBuffer_];
+	if (buffer.fence)
+	{
+		if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			return finished;
+		}
+		glDeleteSync(buffer.fence);
+		buffer.fence = nullptr;
+	}
+	nextBuffer_ = (nextBuffer_ + 1) % buffers_.size();
+
+	// Rows are gathered first, as updates read the buffer once it is unmapped.
+	struct Copy {
+		Pending * pending = nullptr;
+		size_t region = 0;
+		size_t row = 0;
+		size_t rows = 0;
+		size_t offset = 0;
+	};
+	std::vector<Copy> copies;
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+	auto * target = static_cast<std::byte *>(
+		glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(budget_), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+	if (!target)
+	{
+		qWarning() << "Failed to map texture upload buffer";
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		return finished;
+	}
+	size_t used = 0;
+	for (auto & pending: pending_)
+	{
+		for (; pending.region < pending.regions.size(); ++pending.region, pending.row = 0)
+		{
+			const auto & region = pending.regions[pending.region];
+			const auto rowBytes = region.data.size() / rowCount(region);
+			const auto rows = std::min(rowCount(region) - pending.row, (budget_ - used) / rowBytes);
+			if (!rows)
+			{
+				break;
+			}
+			std::memcpy(target + used, region.data.data() + pending.row * rowBytes, rows * rowBytes);
+			copies.push_back({&pending, pending.region, pending.row, rows, used});
+			used += rows * rowBytes;
+			pending.row += rows;
+			if (pending.row < rowCount(region))
+			{
+				break;
+			}
+		}
+		if (pending.region < pending.regions.size())
+		{
+			break;
+		}
+	}
+	glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+	for (const auto & copy: copies)
+	{
+		copy.pending->texture.texture->bind();
+		this->copy(copy.pending->regions[copy.region], copy.row, copy.rows, reinterpret_cast<const void *>(copy.offset));
+	}
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (used)
+	{
+		buffer.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		pendingBytes_ -= used;
+	}
+	else if (auto & pending = pending_.front(); pending.region < pending.regions.size())
+	{
+		// A row larger than a buffer is copied from client memory.
+		const auto & region = pending.regions[pending.region];
+		const auto rowBytes = region.data.size() / rowCount(region);
+		pending.texture.texture->bind();
+		copy(region, pending.row, 1, region.data.data() + pending.row * rowBytes);
+		pendingBytes_ -= rowBytes;
+		if (++pending.row == rowCount(region))
+		{
+			++pending.region;
+			pending.row = 0;
+		}
+	}
+
+	while (!pending_.empty() && pending_.front().region == pending_.front().regions.size())
+	{
+		auto & pending = pending_.front();
+		pending.texture.texture->bind();
+		if (pending.mipmaps)
+		{
+			glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+		}
+		pending.texture.texture->release();
+		finished.push_back(std::move(pending.texture));
+		pending_.pop_front();
+	}
+	return finished;
+}
+
+void TextureUploader::clear()
+{
+	pending_.clear();
+	pendingBytes_ = 0;
+}
+
+bool TextureUploader::isIdle() const noexcept
+{
+	return pending_.empty();
+}
+
+size_t TextureUploader::pendingBytes() const noexcept
+{
+	return pendingBytes_;
+}
+
+size_t TextureUploader::rowCount(const Region & region)
+{
+	const auto rows = region.type ? region.height : (region.height + g_blockDimension - 1) / g_blockDimension;
+	return static_cast<size_t>(std::max(rows, 1));
+}
+
+void TextureUploader::copy(const Region & region, const size_t row, const size_t rows, const void * const data)
+{
+	const auto dimension = region.type ? 1 : g_blockDimension;
+	const auto y = static_cast<GLint>(row) * dimension;
+	// Compressed rows at the bottom edge may be partial blocks.
+	const auto height = std::min(static_cast<GLsizei>(rows) * dimension, region.height - y);
+	if (region.type)
+	{
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, region.level, 0, y, region.layer, region.width, height, 1, region.format, region.type, data);
+	}
+	else
+	{
+		const auto size = region.data.size() / rowCount(region) * rows;
+		glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, region.level, 0, y, region.layer, region.width, height, 1, region.format,
+								  static_cast<GLsizei>(size), data);
+	}
+}
+
+}// namespace fgl
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "TexturePacker.hpp"
+
+#include <QOpenGLExtraFunctions>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <vector>
+
+namespace fgl
+{
+
+// Streams texture data to GL through a ring of pixel unpack buffers, at
+// most budget bytes per upload(), so large textures take several frames
+// instead of stalling one. Regions are copied row by row into the next
+// buffer and updated from its offsets, a buffer is only refilled once its
+// fence is signaled. Textures are handed back when all their regions are
+// copied, in the order they were pushed.
+class TextureUploader final : protected QOpenGLExtraFunctions
+{
+public:
+	// Rows of a level of a layer.
+	struct Region {
+		GLint level = 0;
+		GLint layer = 0;
+		GLsizei width = 0;
+		GLsizei height = 0;
+		// Pixel format and type, or compressed internal format and zero type.
+		GLenum format = 0;
+		GLenum type = 0;
+		gsl::span<const std::byte> data;
+	};
+
+	explicit TextureUploader(size_t budget = 4 << 20, size_t buffers = 3);
+
+	TextureUploader(const TextureUploader &) = delete;
+	TextureUploader(TextureUploader &&) = delete;
+	TextureUploader & operator=(const TextureUploader &) = delete;
+	TextureUploader & operator=(TextureUploader &&) = delete;
+
+	// Both require a bound context, as all calls below. Buffers are only
+	// allocated here, so uploaders that are never used cost nothing.
+	void initialize();
+	void release();
+
+	// Takes 2D array texture with storage allocated for regions. Data of
+	// regions is kept alive by owner until copied. Mips are generated once
+	// regions are copied when mipmaps is set.
+	void push(PackedTexture texture, std::vector<Region> regions, std::shared_ptr<const void> owner, bool mipmaps);
+	// Copies regions within the budget, returns finished textures.
+	[[nodiscard]] std::vector<PackedTexture> upload();
+	// Drops textures not finished yet.
+	void clear();
+
+	[[nodiscard]] bool isIdle() const noexcept;
+	[[nodiscard]] size_t pendingBytes() const noexcept;
+
+private:
+	struct Pending {
+		PackedTexture texture;
+		std::vector<Region> regions;
+		std::shared_ptr<const void> owner;
+		bool mipmaps = false;
+		// Next row of the next region to copy.
+		size_t region = 0;
+		size_t row = 0;
+	};
+
+	struct Buffer {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	// Block rows for compressed formats.
+	[[nodiscard]] static size_t rowCount(const Region & region);
+	// Updates rows of region from data, an offset when a buffer is bound.
+	void copy(const Region & region, size_t row, size_t rows, const void * data);
+
+private:
+	size_t budget_ = 0;
+	std::vector<Buffer> buffers_;
+	size_t nextBuffer_ = 0;
+	std::deque<Pending> pending_;
+	size_t pendingBytes_ = 0;
+};
+
+}// namespace fgl
@@ -0,0 +1,226 @@
+#include "TiledImage.hpp"
+
+#include <QSaveFile>
+
+#include <tinygltf/tiny_gltf.h>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr quint32 g_magic = 0x544C4746;// "FGLT"
+constexpr quint32 g_version = 1;
+
+struct Header {
+	quint32 magic = g_magic;
+	quint32 version = g_version;
+	qint32 width = 0;
+	qint32 height = 0;
+	qint32 levels = 0;
+	quint32 padding = 0;
+};
+
+struct Pixels {
+	int width = 0;
+	int height = 0;
+	std::vector<unsigned char> rgba;
+};
+
+// 2x2 box filter rounding the size up, edges repeat their last texel.
+Pixels downsample(const Pixels & source)
+{
+	Pixels result{(source.width + 1) / 2, (source.height + 1) / 2, {}};
+	result.rgba.resize(static_cast<size_t>(result.width) * static_cast<size_t>(result.height) * 4);
+	for (int y = 0; y < result.height; ++y)
+	{
+		for (int x = 0; x < result.width; ++x)
+		{
+			std::array<int, 4> sum{};
+			for (int dy = 0; dy < 2; ++dy)
+			{
+				for (int dx = 0; dx < 2; ++dx)
+				{
+					const auto sx = static_cast<size_t>(std::min(x * 2 + dx, source.width - 1));
+					const auto sy = static_cast<size_t>(std::min(y * 2 + dy, source.height - 1));
+					const auto * texel = source.rgba.data() + (sy * static_cast<size_t>(source.width) + sx) * 4;
+					for (size_t c = 0; c < 4; ++c)
+					{
+						sum[c] += texel[c];
+					}
+				}
+			}
+			auto * target = result.rgba.data() + (static_cast<size_t>(y) * static_cast<size_t>(result.width) + static_cast<size_t>(x)) * 4;
+			for (size_t c = 0; c < 4; ++c)
+			{
+				target[c] = static_cast<unsigned char>((sum[c] + 2) / 4);
+			}
+		}
+	}
+	return result;
+}
+
+int pagesFor(const int size)
+{
+	return (size + TiledImage::pageSize - 1) / TiledImage::pageSize;
+}
+
+}// namespace
+
+int TiledImage::levelCount(const int width, const int height)
+{
+	auto levels = 1;
+	for (auto size = std::max(width, height); size > pageSize; size = (size + 1) / 2)
+	{
+		++levels;
+	}
+	return levels;
+}
+
+int TiledImage::levelWidth(const int level) const
+{
+	auto size = width;
+	for (int i = 0; i < level; ++i)
+	{
+		size = (size + 1) / 2;
+	}
+	return size;
+}
+
+int TiledImage::levelHeight(const int level) const
+{
+	auto size = height;
+	for (int i = 0; i < level; ++i)
+	{
+		size = (size + 1) / 2;
+	}
+	return size;
+}
+
+int TiledImage::columns(const int level) const
+{
+	return pagesFor(levelWidth(level));
+}
+
+int TiledImage::rows(const int level) const
+{
+	return pagesFor(levelHeight(level));
+}
+
+TiledImage writeTiledImage(const tinygltf::Image & image, const QString & path)
+{
+	const auto size = static_cast<size_t>(std::max(image.width, 0)) * static_cast<size_t>(std::max(image.height, 0)) * 4;
+	if (image.bits != 8 || image.component != 4 || !size || image.image.size() < size)
+	{
+		return {};
+	}
+	TiledImage tiled{path, image.width, image.height, TiledImage::levelCount(image.width, image.height)};
+
+	QSaveFile file(path);
+	if (!file.open(QIODevice::WriteOnly))
+	{
+		return {};
+	}
+	const Header header{g_magic, g_version, tiled.width, tiled.height, tiled.levels, 0};
+	file.write(reinterpret_cast<const char *>(&header), sizeof(Header));
+
+	Pixels level{image.width, image.height, {image.image.begin(), image.image.begin() + static_cast<std::ptrdiff_t>(size)}};
+	std::vector<unsigned char> tile(TiledImage::tileBytes);
+	for (int i = 0; i < tiled.levels; ++i)
+	{
+		const auto rows = tiled.rows(i);
+		const auto columns = tiled.columns(i);
+		for (int ty = 0; ty < rows; ++ty)
+		{
+			for (int tx = 0; tx < columns; ++tx)
+			{
+				// Texels past the level edges are clamped.
+				auto * target = tile.data();
+				for (int y = 0; y < TiledImage::tileSize; ++y)
+				{
+					const auto sy = std::clamp(ty * TiledImage::pageSize + y - TiledImage::border, 0, level.height - 1);
+					for (int x = 0; x < TiledImage::tileSize; ++x, target += 4)
+					{
+						const auto sx = std::clamp(tx * TiledImage::pageSize + x - TiledImage::border, 0, level.width - 1);
+						std::memcpy(target, level.rgba.data() + (static_cast<size_t>(sy) * static_cast<size_t>(level.width) + static_cast<size_t>(sx)) * 4, 4);
+					}
+				}
+				file.write(reinterpret_cast<const char *>(tile.data()), static_cast<qint64>(tile.size()));
+			}
+		}
+		if (i + 1 < tiled.levels)
+		{
+			level = downsample(level);
+		}
+	}
+	if (!file.commit())
+	{
+		return {};
+	}
+	return tiled;
+}
+
+TiledImage readTiledImage(const QString & path)
+{
+	QFile file(path);
+	Header header;
+	if (!file.open(QIODevice::ReadOnly) || file.read(reinterpret_cast<char *>(&header), sizeof(Header)) != sizeof(Header)
+		|| header.magic != g_magic || header.version != g_version || header.width <= 0 || header.height <= 0
+		|| header.levels != TiledImage::levelCount(header.width, header.height))
+	{
+		return {};
+	}
+	return {path, header.width, header.height, header.levels};
+}
+
+bool TiledImageFile::open(const TiledImage & image)
+{
+	image_ = image;
+	file_.setFileName(image.path);
+	firstTiles_.clear();
+	size_t tiles = 0;
+	for (int i = 0; i < image.levels; ++i)
+	{
+		firstTiles_.push_back(tiles);
+		tiles += static_cast<size_t>(image.columns(i)) * static_cast<size_t>(image.rows(i));
+	}
+
+	const auto size = file_.size();
+	const auto * mapped = file_.open(QIODevice::ReadOnly) ? file_.map(0, size) : nullptr;
+	if (!mapped || static_cast<size_t>(size) != sizeof(Header) + tiles * TiledImage::tileBytes)
+	{
+		return false;
+	}
+	Header header;
+	std::memcpy(&header, mapped, sizeof(Header));
+	if (header.magic != g_magic || header.version != g_version || header.width != image.width || header.height != image.height
+		|| header.levels != image.levels)
+	{
+		return false;
+	}
+	data_ = {reinterpret_cast<const std::byte *>(mapped) + sizeof(Header), tiles * TiledImage::tileBytes};
+	return true;
+}
+
+const TiledImage & TiledImageFile::image() const noexcept
+{
+	return image_;
+}
+
+gsl::span<const std::byte> TiledImageFile::tile(const int level, const int x, const int y) const
+{
+	if (level < 0 || level >= image_.levels || x < 0 || y < 0 || x >= image_.columns(level) || y >= image_.rows(level) || data_.empty())
+	{
+		return {};
+	}
+	const auto index = firstTiles_[static_cast<size_t>(level)] + static_cast<size_t>(y) * static_cast<size_t>(image_.columns(level))
+		+ static_cast<size_t>(x);
+	return data_.subspan(index * TiledImage::tileBytes, TiledImage::tileBytes);
+}
+
+}// namespace fgl
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+
+#include <gsl/span>
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace tinygltf
+{
+struct Image;
+}// namespace tinygltf
+
+namespace fgl
+{
+
+// Image cut into square RGBA8 pages for every mip level, down to a level
+// fitting into one page. Levels are halved rounding up. Pages are stored
+// with a border of clamped neighbour texels for bilinear filtering.
+struct TiledImage {
+	static constexpr int pageSize = 128;
+	static constexpr int border = 1;
+	static constexpr int tileSize = pageSize + 2 * border;
+	static constexpr size_t tileBytes = static_cast<size_t>(tileSize) * tileSize * 4;
+
+	QString path;
+	int width = 0;
+	int height = 0;
+	int levels = 0;
+
+	[[nodiscard]] static int levelCount(int width, int height);
+	[[nodiscard]] int levelWidth(int level) const;
+	[[nodiscard]] int levelHeight(int level) const;
+	[[nodiscard]] int columns(int level) const;
+	[[nodiscard]] int rows(int level) const;
+};
+
+// Writes RGBA8 image as tiles into path, returns an empty image on failure.
+[[nodiscard]] TiledImage writeTiledImage(const tinygltf::Image & image, const QString & path);
+// Reads the header of written image, empty one for missing or other files.
+[[nodiscard]] TiledImage readTiledImage(const QString & path);
+
+// Memory mapped tiles of a written image.
+class TiledImageFile final
+{
+public:
+	// Validates the header against the image, false for invalid files.
+	[[nodiscard]] bool open(const TiledImage & image);
+
+	[[nodiscard]] const TiledImage & image() const noexcept;
+	// Tile bytes, rows from the top. Empty outside of the level.
+	[[nodiscard]] gsl::span<const std::byte> tile(int level, int x, int y) const;
+
+private:
+	TiledImage image_;
+	QFile file_;
+	gsl::span<const std::byte> data_;
+	// Index of the first tile of every level.
+	std::vector<size_t> firstTiles_;
+};
+
+}// namespace fgl
@@ -0,0 +1,70 @@
+#include "UniformRing.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace fgl
+{
+
+UniformRing::UniformRing(const size_t frames)
+	: stream_{frames}
+{
+}
+
+void UniformRing::initialize()
+{
+	initializeOpenGLFunctions();
+	GLint alignment = 0;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	alignment_ = static_cast<size_t>(std::max(alignment, 16));
+	stream_.initialize();
+}
+
+void UniformRing::release()
+{
+	stream_.release();
+}
+
+void UniformRing::begin()
+{
+	data_.clear();
+}
+
+size_t UniformRing::append(const void * data, const size_t size)
+{
+	const auto offset = (data_.size() + alignment_ - 1) / alignment_ * alignment_;
+	data_.resize(offset + size);
+	std::memcpy(data_.data() + offset, data, size);
+	return offset;
+}
+
+void UniformRing::upload(InstrumentedFunctions & gl)
+{
+	// Room for aligning the start of the blocks.
+	stream_.begin(data_.size() + alignment_);
+	const auto allocation = stream_.allocate(data_.size(), alignment_);
+	if (allocation.data)
+	{
+		std::memcpy(allocation.data, data_.data(), data_.size());
+		gl.countUpload(data_.size());
+	}
+	base_ = allocation.offset;
+	stream_.finish();
+}
+
+void UniformRing::bind(const GLuint binding, const size_t offset, const size_t size)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, binding, stream_.buffer(), static_cast<GLintptr>(base_ + offset), static_cast<GLsizeiptr>(size));
+}
+
+void UniformRing::fence()
+{
+	stream_.fence();
+}
+
+const StreamBuffer & UniformRing::stream() const noexcept
+{
+	return stream_;
+}
+
+}// namespace fgl
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "InstrumentedFunctions.hpp"
+#include "StreamBuffer.hpp"
+
+#include <QOpenGLExtraFunctions>
+
+#include <cstddef>
+#include <vector>
+
+namespace fgl
+{
+
+// Uniform blocks rewritten every frame. Blocks of a frame are gathered on
+// the CPU, written into the next StreamBuffer partition at once and then
+// bound by range.
+class UniformRing final : protected QOpenGLExtraFunctions
+{
+public:
+	explicit UniformRing(size_t frames = 3);
+
+	UniformRing(const UniformRing &) = delete;
+	UniformRing(UniformRing &&) = delete;
+	UniformRing & operator=(const UniformRing &) = delete;
+	UniformRing & operator=(UniformRing &&) = delete;
+
+	// Both require a bound context.
+	void initialize();
+	void release();
+
+	// Drops blocks of the previous frame.
+	void begin();
+	// Appends a std140 block, returns its offset in the frame data. Offsets
+	// are aligned for glBindBufferRange().
+	[[nodiscard]] size_t append(const void * data, size_t size);
+	template<class Block>
+	[[nodiscard]] size_t append(const Block & block);
+	// Writes blocks appended since begin(). Requires a bound context.
+	void upload(InstrumentedFunctions & gl);
+	// Binds a block appended in this frame to a uniform buffer binding.
+	void bind(GLuint binding, size_t offset, size_t size);
+	// Call after the last draw using blocks of this frame.
+	void fence();
+
+	[[nodiscard]] const StreamBuffer & stream() const noexcept;
+
+private:
+	StreamBuffer stream_;
+	size_t alignment_ = 256;
+	size_t base_ = 0;
+	std::vector<std::byte> data_;
+};
+
+template<class Block>
+size_t UniformRing::append(const Block & block)
+{
+	static_assert(sizeof(Block) % 16 == 0, "std140 blocks are padded to vec4");
+	return append(&block, sizeof(Block));
+}
+
+}// namespace fgl
@@ -0,0 +1,193 @@
+#include "VertexFormat.hpp"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace fgl
+{
+
+namespace
+{
+
+template<class Value>
+Value load(const std::byte * source, const size_t i)
+{
+	Value value{};
+	std::memcpy(&value, source + i * sizeof(Value), sizeof(Value));
+	return value;
+}
+
+template<class Value>
+void store(std::byte * target, const size_t i, const Value value)
+{
+	std::memcpy(target + i * sizeof(Value), &value, sizeof(Value));
+}
+
+// Lower hemisphere is folded over the diagonals of the upper one.
+glm::vec2 encodeOctahedral(glm::vec3 normal)
+{
+	normal /= std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+	if (normal.z >= 0.0f)
+	{
+		return {normal.x, normal.y};
+	}
+	const auto sign = glm::vec2{normal.x >= 0.0f ? 1.0f : -1.0f, normal.y >= 0.0f ? 1.0f : -1.0f};
+	return (1.0f - glm::abs(glm::vec2{normal.y, normal.x})) * sign;
+}
+
+}// namespace
+
+size_t componentSize(const GLenum type)
+{
+	switch (type)
+	{
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+		default:
+			return 4;
+	}
+}
+
+GLenum VertexElement::type() const
+{
+	switch (encoding)
+	{
+		case VertexEncoding::Half:
+			return GL_HALF_FLOAT;
+		case VertexEncoding::Snorm16:
+		case VertexEncoding::Octahedral:
+			return GL_SHORT;
+		case VertexEncoding::Unorm8:
+			return GL_UNSIGNED_BYTE;
+		default:
+			return GL_FLOAT;
+	}
+}
+
+GLint VertexElement::storedComponents() const
+{
+	return encoding == VertexEncoding::Octahedral ? 2 : components;
+}
+
+bool VertexElement::normalized() const
+{
+	return type() == GL_SHORT || type() == GL_UNSIGNED_BYTE;
+}
+
+size_t VertexElement::size() const
+{
+	return componentSize(type()) * static_cast<size_t>(storedComponents());
+}
+
+VertexFormat & VertexFormat::add(const Attribute location, const VertexEncoding encoding, const GLint components)
+{
+	auto & element = elements_.emplace_back(VertexElement{location, encoding, components, static_cast<size_t>(stride_)});
+	stride_ += static_cast<GLsizei>((element.size() + 3) & ~size_t{3});
+	return *this;
+}
+
+const std::vector<VertexElement> & VertexFormat::elements() const noexcept
+{
+	return elements_;
+}
+
+const VertexElement * VertexFormat::find(const Attribute location) const
+{
+	const auto found = std::find_if(elements_.begin(), elements_.end(), [&](const auto & element) { return element.location == location; });
+	return found == elements_.end() ? nullptr : &*found;
+}
+
+GLsizei VertexFormat::stride() const noexcept
+{
+	return stride_;
+}
+
+void VertexFormat::encode(const VertexElement & element, const float * value, std::byte * vertex)
+{
+	auto * target = vertex + element.offset;
+	const auto count = static_cast<size_t>(element.components);
+	switch (element.encoding)
+	{
+		case VertexEncoding::Float:
+			std::memcpy(target, value, count * sizeof(float));
+			break;
+		case VertexEncoding::Half:
+			for (size_t i = 0; i < count; ++i)
+			{
+				store(target, i, glm::packHalf1x16(value[i]));
+			}
+			break;
+		case VertexEncoding::Snorm16:
+			for (size_t i = 0; i < count; ++i)
+			{
+				store(target, i, static_cast<int16_t>(glm::packSnorm1x16(value[i])));
+			}
+			break;
+		case VertexEncoding::Unorm8:
+			for (size_t i = 0; i < count; ++i)
+			{
+				store(target, i, glm::packUnorm1x8(value[i]));
+			}
+			break;
+		case VertexEncoding::Octahedral:
+		{
+			const glm::vec3 normal{value[0], value[1], value[2]};
+			const auto encoded = glm::dot(normal, normal) > 0.0f ? encodeOctahedral(normal) : glm::vec2{0.0f};
+			store(target, 0, static_cast<int16_t>(glm::packSnorm1x16(encoded.x)));
+			store(target, 1, static_cast<int16_t>(glm::packSnorm1x16(encoded.y)));
+			break;
+		}
+	}
+}
+
+void readComponents(const GLenum type, const bool normalized, const GLint components, const std::byte * source, float * value)
+{
+	for (size_t i = 0; i < static_cast<size_t>(components); ++i)
+	{
+		switch (type)
+		{
+			case GL_BYTE:
+			{
+				const auto raw = static_cast<float>(load<int8_t>(source, i));
+				value[i] = normalized ? std::max(raw / 127.0f, -1.0f) : raw;
+				break;
+			}
+			case GL_UNSIGNED_BYTE:
+			{
+				const auto raw = static_cast<float>(load<uint8_t>(source, i));
+				value[i] = normalized ? raw / 255.0f : raw;
+				break;
+			}
+			case GL_SHORT:
+			{
+				const auto raw = static_cast<float>(load<int16_t>(source, i));
+				value[i] = normalized ? std::max(raw / 32767.0f, -1.0f) : raw;
+				break;
+			}
+			case GL_UNSIGNED_SHORT:
+			{
+				const auto raw = static_cast<float>(load<uint16_t>(source, i));
+				value[i] = normalized ? raw / 65535.0f : raw;
+				break;
+			}
+			case GL_HALF_FLOAT:
+				value[i] = glm::unpackHalf1x16(load<uint16_t>(source, i));
+				break;
+			default:
+				value[i] = load<float>(source, i);
+				break;
+		}
+	}
+}
+
+}// namespace fgl
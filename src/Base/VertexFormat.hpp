@@ -0,0 +1,65 @@
+#pragma once
+
+#include "Scene.hpp"
+
+#include <QOpenGLFunctions>
+
+#include <cstddef>
+#include <vector>
+
+namespace fgl
+{
+
+// Storage of vertex attribute components. Integer encodings are fetched
+// normalized.
+enum class VertexEncoding
+{
+	Float,
+	Half,
+	Snorm16,
+	Unorm8,
+	// Unit vector folded onto an octahedron, two snorm16 components
+	// decoded in the shader.
+	Octahedral,
+};
+
+struct VertexElement {
+	Attribute location = Attribute::Position;
+	VertexEncoding encoding = VertexEncoding::Float;
+	// Components of the value before encoding.
+	GLint components = 0;
+	size_t offset = 0;
+
+	[[nodiscard]] GLenum type() const;
+	[[nodiscard]] GLint storedComponents() const;
+	[[nodiscard]] bool normalized() const;
+	[[nodiscard]] size_t size() const;
+};
+
+// Interleaved vertex layout. Offsets and stride are derived from encodings
+// as elements are added, every element starts at a multiple of 4 bytes.
+class VertexFormat final
+{
+public:
+	VertexFormat & add(Attribute location, VertexEncoding encoding, GLint components);
+
+	[[nodiscard]] const std::vector<VertexElement> & elements() const noexcept;
+	[[nodiscard]] const VertexElement * find(Attribute location) const;
+	[[nodiscard]] GLsizei stride() const noexcept;
+
+	// Encodes element components of value into vertex at element offset.
+	static void encode(const VertexElement & element, const float * value, std::byte * vertex);
+
+private:
+	std::vector<VertexElement> elements_;
+	GLsizei stride_ = 0;
+};
+
+// Bytes of a GL_BYTE to GL_FLOAT or GL_HALF_FLOAT component.
+[[nodiscard]] size_t componentSize(GLenum type);
+
+// Reads components of a glTF accessor element, integer ones are mapped to
+// [0, 1] or [-1, 1] when normalized.
+void readComponents(GLenum type, bool normalized, GLint components, const std::byte * source, float * value);
+
+}// namespace fgl
@@ -0,0 +1,439 @@
+#include "VirtualTexture.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+
+namespace fgl
+{
+
+namespace
+{
+
+constexpr size_t g_readbacks = 3;
+// Bounds upload time of a frame.
+constexpr size_t g_pagesPerUpdate = 16;
+constexpr uint32_t g_resident = 0xFF000000;
+
+}// namespace
+
+VirtualTexture::VirtualTexture(const int cacheTiles)
+	: cacheTiles_{cacheTiles}
+{
+}
+
+void VirtualTexture::initialize()
+{
+	initializeOpenGLFunctions();
+
+	// Entries are slot x, slot y, level of the page and a resident mark.
+	glGenTextures(1, &pageTable_);
+	glBindTexture(GL_TEXTURE_2D, pageTable_);
+	for (int level = 0; level < levels; ++level)
+	{
+		const auto size = pages >> level;
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+
+	glGenTextures(1, &cache_);
+	glBindTexture(GL_TEXTURE_2D, cache_);
+	const auto cacheSize = cacheTiles_ * TiledImage::tileSize;
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheSize, cacheSize, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &feedbackFramebuffer_);
+	glGenRenderbuffers(1, &feedbackColor_);
+	glGenRenderbuffers(1, &feedbackDepth_);
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer_);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackColor_);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, feedbackColor_);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth_);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, feedbackDepth_);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	feedbackWidth_ = 0;
+	feedbackHeight_ = 0;
+
+	pixelBuffers_.resize(g_readbacks);
+	glGenBuffers(static_cast<GLsizei>(pixelBuffers_.size()), pixelBuffers_.data());
+
+	slots_.resize(static_cast<size_t>(cacheTiles_) * static_cast<size_t>(cacheTiles_));
+	clear();
+}
+
+void VirtualTexture::release()
+{
+	for (const auto & readback: readbacks_)
+	{
+		glDeleteSync(readback.fence);
+	}
+	readbacks_.clear();
+	glDeleteBuffers(static_cast<GLsizei>(pixelBuffers_.size()), pixelBuffers_.data());
+	pixelBuffers_.clear();
+	glDeleteFramebuffers(1, &feedbackFramebuffer_);
+	glDeleteRenderbuffers(1, &feedbackColor_);
+	glDeleteRenderbuffers(1, &feedbackDepth_);
+	glDeleteTextures(1, &pageTable_);
+	glDeleteTextures(1, &cache_);
+	feedbackFramebuffer_ = feedbackColor_ = feedbackDepth_ = pageTable_ = cache_ = 0;
+	images_.clear();
+}
+
+int VirtualTexture::add(const TiledImage & image)
+{
+	const auto level = image.levels - 1;
+	if (level < 0 || level >= levels)
+	{
+		return -1;
+	}
+	auto file = std::make_unique<TiledImageFile>();
+	if (!file->open(image))
+	{
+		qWarning() << "Failed to open tiles" << image.path;
+		return -1;
+	}
+	int x = 0;
+	int y = 0;
+	if (!allocateRegion(level, x, y))
+	{
+		return -1;
+	}
+	images_.push_back({std::move(file), x, y, level});
+	// Coarsest page covers the whole region and is never evicted.
+	if (!load(pageKey(level, x >> level, y >> level), true))
+	{
+		images_.pop_back();
+		return -1;
+	}
+	return static_cast<int>(images_.size() - 1);
+}
+
+void VirtualTexture::clear()
+{
+	images_.clear();
+	for (auto & regions: freeRegions_)
+	{
+		regions.clear();
+	}
+	freeRegions_[levels - 1].emplace_back(0, 0);
+
+	std::fill(slots_.begin(), slots_.end(), Slot{});
+	resident_.clear();
+	missing_ = 0;
+	for (int level = 0; level < levels; ++level)
+	{
+		const auto size = static_cast<size_t>(pages >> level);
+		table_[static_cast<size_t>(level)].assign(size * size, 0);
+	}
+	dirty_.fill(true);
+}
+
+std::array<float, 4> VirtualTexture::rect(const int image) const
+{
+	const auto & region = images_[static_cast<size_t>(image)];
+	const auto & tiled = region.file->image();
+	constexpr auto virtualSize = static_cast<float>(pages * TiledImage::pageSize);
+	return {static_cast<float>(region.x) / pages, static_cast<float>(region.y) / pages, static_cast<float>(tiled.width) / virtualSize,
+			static_cast<float>(tiled.height) / virtualSize};
+}
+
+int VirtualTexture::maxLevel(const int image) const
+{
+	return images_[static_cast<size_t>(image)].level;
+}
+
+bool VirtualTexture::beginFeedback(const int width, const int height)
+{
+	if (images_.empty() || readbacks_.size() == pixelBuffers_.size())
+	{
+		return false;
+	}
+	resizeFeedback(std::max(width / feedbackScale, 1), std::max(height / feedbackScale, 1));
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &savedDrawFramebuffer_);
+	glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &savedReadFramebuffer_);
+	glGetIntegerv(GL_VIEWPORT, savedViewport_.data());
+	glBindFramebuffer(GL_FRAMEBUFFER, feedbackFramebuffer_);
+	glViewport(0, 0, feedbackWidth_, feedbackHeight_);
+	// Clear color of the window is kept.
+	const std::array<GLfloat, 4> none{};
+	const GLfloat far = 1.0f;
+	glClearBufferfv(GL_COLOR, 0, none.data());
+	glClearBufferfv(GL_DEPTH, 0, &far);
+	return true;
+}
+
+void VirtualTexture::endFeedback()
+{
+	// Buffers are reused in order, the oldest one is free.
+	const auto buffer = pixelBuffers_[nextBuffer_];
+	nextBuffer_ = (nextBuffer_ + 1) % pixelBuffers_.size();
+	const auto size = static_cast<size_t>(feedbackWidth_) * static_cast<size_t>(feedbackHeight_) * 4;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, buffer);
+	glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(size), nullptr, GL_STREAM_READ);
+	glReadPixels(0, 0, feedbackWidth_, feedbackHeight_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+	readbacks_.push_back({buffer, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), size});
+
+	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, static_cast<GLuint>(savedDrawFramebuffer_));
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, static_cast<GLuint>(savedReadFramebuffer_));
+	glViewport(savedViewport_[0], savedViewport_[1], savedViewport_[2], savedViewport_[3]);
+}
+
+void VirtualTexture::update()
+{
+	++frame_;
+
+	// Feedback texels are page keys with the resident mark.
+	requests_.clear();
+	while (!readbacks_.empty())
+	{
+		auto & readback = readbacks_.front();
+		if (glClientWaitSync(readback.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		{
+			break;
+		}
+		glDeleteSync(readback.fence);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+		if (const auto * texels = static_cast<const uint32_t *>(
+				glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(readback.size), GL_MAP_READ_BIT)))
+		{
+			for (size_t i = 0; i < readback.size / sizeof(uint32_t); ++i)
+			{
+				if (texels[i] & g_resident)
+				{
+					requests_.push_back(texels[i] & ~g_resident);
+				}
+			}
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		readbacks_.pop_front();
+	}
+
+	if (!requests_.empty())
+	{
+		std::sort(requests_.begin(), requests_.end());
+		requests_.erase(std::unique(requests_.begin(), requests_.end()), requests_.end());
+		// Requested pages are kept, missing ones load from the coarsest.
+		std::vector<uint32_t> missing;
+		for (const auto page: requests_)
+		{
+			if (const auto found = resident_.find(page); found != resident_.end())
+			{
+				slots_[found->second].used = frame_;
+			}
+			else
+			{
+				missing.push_back(page);
+			}
+		}
+		std::stable_sort(missing.begin(), missing.end(), [](const auto lhs, const auto rhs) { return (lhs >> 16) > (rhs >> 16); });
+		size_t loaded = 0;
+		for (const auto page: missing)
+		{
+			if (loaded == g_pagesPerUpdate)
+			{
+				break;
+			}
+			loaded += load(page, false) ? 1 : 0;
+		}
+		missing_ = missing.size() - loaded;
+	}
+
+	if (std::find(dirty_.begin(), dirty_.end(), true) != dirty_.end())
+	{
+		glBindTexture(GL_TEXTURE_2D, pageTable_);
+		for (int level = 0; level < levels; ++level)
+		{
+			if (dirty_[static_cast<size_t>(level)])
+			{
+				const auto size = pages >> level;
+				glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, table_[static_cast<size_t>(level)].data());
+			}
+		}
+		glBindTexture(GL_TEXTURE_2D, 0);
+		dirty_.fill(false);
+	}
+}
+
+void VirtualTexture::bind(const GLuint pageTableUnit, const GLuint cacheUnit)
+{
+	glActiveTexture(GL_TEXTURE0 + pageTableUnit);
+	glBindTexture(GL_TEXTURE_2D, pageTable_);
+	glActiveTexture(GL_TEXTURE0 + cacheUnit);
+	glBindTexture(GL_TEXTURE_2D, cache_);
+}
+
+size_t VirtualTexture::residentPages() const noexcept
+{
+	return resident_.size();
+}
+
+size_t VirtualTexture::missingPages() const noexcept
+{
+	return missing_;
+}
+
+uint32_t VirtualTexture::pageKey(const int level, const int x, const int y)
+{
+	return static_cast<uint32_t>(level << 16 | y << 8 | x);
+}
+
+bool VirtualTexture::allocateRegion(const int level, int & x, int & y)
+{
+	// Regions are aligned to their size, so coarser levels never mix images.
+	auto from = static_cast<size_t>(level);
+	while (from < freeRegions_.size() && freeRegions_[from].empty())
+	{
+		++from;
+	}
+	if (from == freeRegions_.size())
+	{
+		return false;
+	}
+	auto [rx, ry] = freeRegions_[from].back();
+	freeRegions_[from].pop_back();
+	while (from > static_cast<size_t>(level))
+	{
+		--from;
+		const auto half = 1 << from;
+		freeRegions_[from].emplace_back(rx + half, ry);
+		freeRegions_[from].emplace_back(rx, ry + half);
+		freeRegions_[from].emplace_back(rx + half, ry + half);
+	}
+	x = rx;
+	y = ry;
+	return true;
+}
+
+bool VirtualTexture::load(const uint32_t page, const bool pinned)
+{
+	const auto level = static_cast<int>(page >> 16);
+	const auto y = static_cast<int>((page >> 8) & 0xFF);
+	const auto x = static_cast<int>(page & 0xFF);
+	const auto owner = std::find_if(images_.begin(), images_.end(), [&](const Image & image) {
+		if (level > image.level)
+		{
+			return false;
+		}
+		const auto size = 1 << (image.level - level);
+		return x >= image.x >> level && x < (image.x >> level) + size && y >= image.y >> level && y < (image.y >> level) + size;
+	});
+	if (owner == images_.end())
+	{
+		return false;
+	}
+	// Regions are padded to powers of two, pages past the image have no tiles.
+	const auto tile = owner->file->tile(level, x - (owner->x >> level), y - (owner->y >> level));
+	if (tile.empty())
+	{
+		return false;
+	}
+
+	// Pages requested this frame are not evicted.
+	auto slot = slots_.size();
+	for (size_t i = 0; i < slots_.size(); ++i)
+	{
+		const auto & candidate = slots_[i];
+		if (!candidate.occupied)
+		{
+			slot = i;
+			break;
+		}
+		if (!candidate.pinned && candidate.used < frame_ && (slot == slots_.size() || candidate.used < slots_[slot].used))
+		{
+			slot = i;
+		}
+	}
+	if (slot == slots_.size())
+	{
+		return false;
+	}
+	if (slots_[slot].occupied)
+	{
+		evict(slot);
+	}
+
+	const auto slotX = static_cast<int>(slot) % cacheTiles_;
+	const auto slotY = static_cast<int>(slot) / cacheTiles_;
+	glBindTexture(GL_TEXTURE_2D, cache_);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, slotX * TiledImage::tileSize, slotY * TiledImage::tileSize, TiledImage::tileSize,
+					TiledImage::tileSize, GL_RGBA, GL_UNSIGNED_BYTE, tile.data());
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	slots_[slot] = {page, frame_, true, pinned};
+	resident_[page] = slot;
+	map(page, static_cast<uint32_t>(slotX | slotY << 8 | level << 16) | g_resident, false);
+	return true;
+}
+
+void VirtualTexture::evict(const size_t slot)
+{
+	auto & evicted = slots_[slot];
+	resident_.erase(evicted.page);
+	// Entries fall back to the nearest coarser resident page, which the
+	// parent entry already points to.
+	const auto level = static_cast<int>(evicted.page >> 16);
+	const auto y = static_cast<size_t>((evicted.page >> 8) & 0xFF);
+	const auto x = static_cast<size_t>(evicted.page & 0xFF);
+	uint32_t parent = 0;
+	if (level + 1 < levels)
+	{
+		const auto size = static_cast<size_t>(pages >> (level + 1));
+		parent = table_[static_cast<size_t>(level + 1)][(y >> 1) * size + (x >> 1)];
+	}
+	map(evicted.page, parent, true);
+	evicted = {};
+}
+
+void VirtualTexture::map(const uint32_t page, const uint32_t entry, const bool replace)
+{
+	const auto level = static_cast<int>(page >> 16);
+	const auto y = static_cast<int>((page >> 8) & 0xFF);
+	const auto x = static_cast<int>(page & 0xFF);
+	for (int l = level; l >= 0; --l)
+	{
+		const auto span = 1 << (level - l);
+		const auto size = static_cast<size_t>(pages >> l);
+		auto & table = table_[static_cast<size_t>(l)];
+		for (auto ty = static_cast<size_t>(y * span); ty < static_cast<size_t>((y + 1) * span); ++ty)
+		{
+			for (auto tx = static_cast<size_t>(x * span); tx < static_cast<size_t>((x + 1) * span); ++tx)
+			{
+				auto & current = table[ty * size + tx];
+				const auto empty = !(current & g_resident);
+				const auto currentLevel = static_cast<int>((current >> 16) & 0xFF);
+				if (replace ? !empty && currentLevel == level : empty || currentLevel >= level)
+				{
+					current = entry;
+				}
+			}
+		}
+		dirty_[static_cast<size_t>(l)] = true;
+	}
+}
+
+void VirtualTexture::resizeFeedback(const int width, const int height)
+{
+	if (width == feedbackWidth_ && height == feedbackHeight_)
+	{
+		return;
+	}
+	feedbackWidth_ = width;
+	feedbackHeight_ = height;
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackColor_);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, feedbackDepth_);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+}
+
+}// namespace fgl
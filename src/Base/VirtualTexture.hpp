@@ -0,0 +1,138 @@
+#pragma once
+
+#include "TiledImage.hpp"
+
+#include <QOpenGLExtraFunctions>
+
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace fgl
+{
+
+// Streams pages of tiled images into a fixed size cache texture, so
+// resident texture memory does not depend on the scene. Images take square
+// power of two regions of a virtual space of pages x pages. A page table
+// texture has a level per mip level and maps every virtual page to a cache
+// slot holding it, or to the nearest coarser resident page. The coarsest
+// page of every image stays resident.
+//
+// Pages to load come from a feedback pass drawn at low resolution, every
+// texel holding the page a fragment wants. Feedback is read back into a
+// ring of pixel pack buffers and mapped once its fence is signaled, so the
+// pipeline never stalls. Least recently requested pages are evicted.
+class VirtualTexture final : protected QOpenGLExtraFunctions
+{
+public:
+	static constexpr int pages = 256;
+	static constexpr int levels = 9;
+	// Feedback is drawn at this fraction of the viewport.
+	static constexpr int feedbackScale = 8;
+
+	// Cache holds cacheTiles x cacheTiles pages.
+	explicit VirtualTexture(int cacheTiles = 16);
+
+	VirtualTexture(const VirtualTexture &) = delete;
+	VirtualTexture(VirtualTexture &&) = delete;
+	VirtualTexture & operator=(const VirtualTexture &) = delete;
+	VirtualTexture & operator=(VirtualTexture &&) = delete;
+
+	// Both require a bound context, as all calls below.
+	void initialize();
+	void release();
+
+	// Maps image into the virtual space and loads its coarsest page.
+	// Returns its id, or -1 when the space or pinned pages are exhausted.
+	[[nodiscard]] int add(const TiledImage & image);
+	// Drops all images and pages.
+	void clear();
+
+	// Offset and scale of the image in virtual UVs.
+	[[nodiscard]] std::array<float, 4> rect(int image) const;
+	[[nodiscard]] int maxLevel(int image) const;
+
+	// Binds and clears the feedback target for a viewport, false when no
+	// read back buffer is free or nothing is virtual. Bound framebuffers
+	// and viewport are saved, they are not always the widget's ones.
+	[[nodiscard]] bool beginFeedback(int width, int height);
+	// Starts reading feedback back, restores framebuffers and viewport.
+	void endFeedback();
+	// Takes finished feedback, loads missing pages within a budget and
+	// uploads changed page table levels. Call once per frame before drawing.
+	void update();
+
+	// Binds page table and cache, leaves cacheUnit active.
+	void bind(GLuint pageTableUnit, GLuint cacheUnit);
+
+	[[nodiscard]] size_t residentPages() const noexcept;
+	// Pages requested by feedback but not resident.
+	[[nodiscard]] size_t missingPages() const noexcept;
+
+private:
+	struct Image {
+		std::unique_ptr<TiledImageFile> file;
+		// Region origin in pages and its size as a power of two.
+		int x = 0;
+		int y = 0;
+		int level = 0;
+	};
+
+	struct Slot {
+		uint32_t page = 0;
+		uint64_t used = 0;
+		bool occupied = false;
+		bool pinned = false;
+	};
+
+	struct Readback {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+		size_t size = 0;
+	};
+
+	[[nodiscard]] static uint32_t pageKey(int level, int x, int y);
+	[[nodiscard]] bool allocateRegion(int level, int & x, int & y);
+	// Loads page into a free or least recently used slot, false when none is
+	// available or the page is outside of images.
+	bool load(uint32_t page, bool pinned);
+	void evict(size_t slot);
+	// Points page table entries under page to entry where they point to
+	// coarser pages, or to pages of level when replacing.
+	void map(uint32_t page, uint32_t entry, bool replace);
+	void resizeFeedback(int width, int height);
+
+private:
+	int cacheTiles_ = 0;
+	GLuint pageTable_ = 0;
+	GLuint cache_ = 0;
+	std::array<std::vector<uint32_t>, levels> table_;
+	std::array<bool, levels> dirty_{};
+
+	std::vector<Image> images_;
+	// Free region origins by size level.
+	std::array<std::vector<std::pair<int, int>>, levels> freeRegions_;
+
+	std::vector<Slot> slots_;
+	std::unordered_map<uint32_t, size_t> resident_;
+	std::vector<uint32_t> requests_;
+	size_t missing_ = 0;
+	uint64_t frame_ = 0;
+
+	GLuint feedbackFramebuffer_ = 0;
+	GLuint feedbackColor_ = 0;
+	GLuint feedbackDepth_ = 0;
+	int feedbackWidth_ = 0;
+	int feedbackHeight_ = 0;
+	GLint savedDrawFramebuffer_ = 0;
+	GLint savedReadFramebuffer_ = 0;
+	std::array<GLint, 4> savedViewport_{};
+	std::vector<GLuint> pixelBuffers_;
+	std::deque<Readback> readbacks_;
+	size_t nextBuffer_ = 0;
+};
+
+}// namespace fgl